@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/openthread.h>
+#include <openthread/coap.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include "alarm.h"
+#include "oscore_client.h"
+
+LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
+
+/* Alarms go out one at a time from the transmit queue */
+static alarm_done_cb_t alarm_done;
+
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+static int on_protected_alarm_ack(const struct coap_packet *response,
+				  struct coap_reply *reply,
+				  const struct sockaddr *from)
+{
+	ARG_UNUSED(reply);
+	ARG_UNUSED(from);
+
+	if (!response) {
+		LOG_WRN("Protected alarm not acknowledged");
+	}
+
+	alarm_done(response != NULL);
+
+	return 0;
+}
+
+int alarm_send(const struct sockaddr_in6 *addr, const char *const *path,
+	       const char *text, size_t len, alarm_done_cb_t done)
+{
+	int ret;
+
+	if (addr->sin6_addr.s6_addr16[0] == 0) {
+		LOG_WRN("Peer address not set, alarm lost: %.*s", (int)len, text);
+		return -ENOTCONN;
+	}
+
+	LOG_INF("Sending alarm: %.*s", (int)len, text);
+
+	/* The OpenThread service can't carry OSCORE, it has its own socket */
+	alarm_done = done;
+	ret = oscore_client_send(true, COAP_METHOD_POST, addr, path,
+				 (const uint8_t *)text, len,
+				 on_protected_alarm_ack);
+	if (ret) {
+		LOG_ERR("Cannot send protected 'alarm' request: %d", ret);
+		return -EIO;
+	}
+
+	return 0;
+}
+#else
+/* Give up on an ACK within a few seconds, the node may need help now */
+static const otCoapTxParameters alarm_tx_params = {
+	.mAckTimeout = 2000,
+	.mAckRandomFactorNumerator = 3,
+	.mAckRandomFactorDenominator = 2,
+	.mMaxRetransmit = 2,
+};
+
+static void on_alarm_ack(void *context, otMessage *message,
+			 const otMessageInfo *message_info, otError result)
+{
+	ARG_UNUSED(context);
+	ARG_UNUSED(message);
+	ARG_UNUSED(message_info);
+
+	if (result != OT_ERROR_NONE) {
+		LOG_WRN("Alarm not acknowledged: %d", result);
+	}
+
+	alarm_done(result == OT_ERROR_NONE);
+}
+
+int alarm_send(const struct sockaddr_in6 *addr, const char *const *path,
+	       const char *text, size_t len, alarm_done_cb_t done)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otMessageInfo message_info = { 0 };
+	otMessage *message;
+	otError error = OT_ERROR_NO_BUFS;
+
+	if (addr->sin6_addr.s6_addr16[0] == 0) {
+		LOG_WRN("Peer address not set, alarm lost: %.*s", (int)len, text);
+		return -ENOTCONN;
+	}
+
+	LOG_INF("Sending alarm: %.*s", (int)len, text);
+
+	openthread_api_mutex_lock(context);
+
+	message = otCoapNewMessage(context->instance, NULL);
+	if (message == NULL) {
+		goto exit;
+	}
+
+	otCoapMessageInit(message, OT_COAP_TYPE_CONFIRMABLE, OT_COAP_CODE_POST);
+	otCoapMessageGenerateToken(message, OT_COAP_DEFAULT_TOKEN_LENGTH);
+
+	error = OT_ERROR_NONE;
+	for (int i = 0; path[i] && error == OT_ERROR_NONE; i++) {
+		error = otCoapMessageAppendUriPathOptions(message, path[i]);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendContentFormatOption(
+			message, OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageSetPayloadMarker(message);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otMessageAppend(message, text, len);
+	}
+	if (error != OT_ERROR_NONE) {
+		goto exit;
+	}
+
+	memcpy(&message_info.mPeerAddr, &addr->sin6_addr,
+	       sizeof(message_info.mPeerAddr));
+	message_info.mPeerPort = ntohs(addr->sin6_port);
+
+	alarm_done = done;
+	error = otCoapSendRequestWithParameters(context->instance, message,
+						&message_info, on_alarm_ack,
+						NULL, &alarm_tx_params);
+
+exit:
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send 'alarm' request: %d", error);
+		if (message) {
+			otMessageFree(message);
+		}
+	}
+
+	openthread_api_mutex_unlock(context);
+
+	return (error == OT_ERROR_NONE) ? 0 :
+	       (error == OT_ERROR_NO_BUFS) ? -ENOMEM : -EIO;
+}
+#endif /* CONFIG_COAP_CLIENT_OSCORE */
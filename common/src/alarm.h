@@ -0,0 +1,48 @@
+/**
+ * @file
+ * @defgroup alarm Alarm events sent to the server
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __ALARM_H__
+#define __ALARM_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/socket.h>
+
+/** @brief Type indicates function called when an alarm exchange ends.
+ *
+ * @param[in] acked true if the server acknowledged the alarm.
+ */
+typedef void (*alarm_done_cb_t)(bool acked);
+
+/** @brief POST an alarm to the server as a confirmable request.
+ *
+ * Alarms give up on the ACK within a few seconds. With OSCORE enabled
+ * they are protected and never sent in plain text.
+ *
+ * @param[in] addr Server address, unset if the node is not provisioned.
+ * @param[in] path Uri-Path segments, NULL terminated.
+ * @param[in] text Alarm payload, e.g. "temp=45.2".
+ * @param[in] len  Payload length.
+ * @param[in] done Called when the exchange ends, only if 0 is returned.
+ *
+ * @retval 0          Alarm sent.
+ * @retval -ENOTCONN  Server address not set, the alarm is lost.
+ * @retval -ENOMEM    No message buffer.
+ * @retval -EIO       The request could not be sent.
+ */
+int alarm_send(const struct sockaddr_in6 *addr, const char *const *path,
+	       const char *text, size_t len, alarm_done_cb_t done);
+
+#endif
+
+/**
+ * @}
+ */
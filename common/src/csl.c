@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/openthread.h>
+#include <openthread/link.h>
+
+#include "csl.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+static uint32_t csl_period_ms = CONFIG_COAP_CLIENT_CSL_PERIOD_MS;
+
+static uint16_t csl_period_units(uint32_t period_ms)
+{
+	return period_ms * USEC_PER_MSEC / CSL_PERIOD_UNIT_US;
+}
+
+int csl_set_period(uint32_t period_ms)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otError error = OT_ERROR_NONE;
+
+	if (period_ms == 0 || period_ms > CSL_PERIOD_MAX_MS) {
+		return -EINVAL;
+	}
+
+	csl_period_ms = period_ms;
+
+	/* Only a sleepy child samples the channel, MED keeps receiving */
+	openthread_api_mutex_lock(context);
+	if (!otThreadGetLinkMode(context->instance).mRxOnWhenIdle) {
+		error = otLinkCslSetPeriod(context->instance,
+					   csl_period_units(period_ms));
+	}
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to set CSL period: %d", error);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+int csl_start(void)
+{
+	return csl_set_period(csl_period_ms);
+}
+
+uint32_t csl_get_period(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	uint16_t period;
+
+	openthread_api_mutex_lock(context);
+	period = otLinkCslGetPeriod(context->instance);
+	openthread_api_mutex_unlock(context);
+
+	return period * CSL_PERIOD_UNIT_US / USEC_PER_MSEC;
+}
+
+otError csl_enable(otInstance *instance, bool enable)
+{
+	return otLinkCslSetPeriod(instance,
+				  enable ? csl_period_units(csl_period_ms) : 0);
+}
+
+otError csl_toggle_link_mode(otInstance *instance, otLinkModeConfig *mode)
+{
+	otError error;
+
+	if (mode->mRxOnWhenIdle) {
+		mode->mRxOnWhenIdle = false;
+		error = otThreadSetLinkMode(instance, *mode);
+	} else if (otLinkCslGetPeriod(instance) == 0) {
+		error = csl_enable(instance, true);
+	} else {
+		csl_enable(instance, false);
+		mode->mRxOnWhenIdle = true;
+		error = otThreadSetLinkMode(instance, *mode);
+	}
+
+	LOG_INF("Link mode: %s", mode->mRxOnWhenIdle ? "MED" :
+		otLinkCslGetPeriod(instance) ? "SSED" : "SED");
+
+	return error;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file
+ * @defgroup csl Synchronized sleepy end device (CSL receiver) support
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __CSL_H__
+#define __CSL_H__
+
+#include <zephyr/kernel.h>
+#include <openthread/instance.h>
+#include <openthread/thread.h>
+
+/* OpenThread counts the CSL period in units of 10 symbols, 160 us */
+#define CSL_PERIOD_UNIT_US 160
+#define CSL_PERIOD_MAX_MS (UINT16_MAX * CSL_PERIOD_UNIT_US / USEC_PER_MSEC)
+
+/** @brief Set the CSL period, applied right away on a sleepy child.
+ *
+ * @param[in] period_ms CSL period in milliseconds.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL Period out of range.
+ * @retval -EIO    OpenThread refused the period.
+ */
+int csl_set_period(uint32_t period_ms);
+
+/** @brief Apply the configured period, once the stack has started.
+ */
+int csl_start(void);
+
+/** @brief Get the CSL period in use, 0 when not sampling.
+ */
+uint32_t csl_get_period(void);
+
+/** @brief Start sampling at the configured period, or stop.
+ *
+ * @note Called with the OpenThread API mutex held.
+ */
+otError csl_enable(otInstance *instance, bool enable);
+
+/** @brief Move to the next link mode, MED -> SED -> SSED (CSL) -> MED.
+ *
+ * @note Called with the OpenThread API mutex held.
+ *
+ * @param[in]     instance OpenThread instance.
+ * @param[in,out] mode     Current link mode, updated to the new one.
+ */
+otError csl_toggle_link_mode(otInstance *instance, otLinkModeConfig *mode);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,45 @@
+/**
+ * @file
+ * @defgroup hot_path_log Logging on the per-period paths
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __HOT_PATH_LOG_H__
+#define __HOT_PATH_LOG_H__
+
+#include <zephyr/logging/log.h>
+
+/* Messages logged on every sample, report or control period. Without
+ * CONFIG_COAP_CLIENT_HOT_PATH_LOG they compile to nothing, format strings
+ * and argument conversions included, while the arguments are still type
+ * checked. Use them after LOG_MODULE_REGISTER() or LOG_MODULE_DECLARE().
+ */
+#if defined(CONFIG_COAP_CLIENT_HOT_PATH_LOG)
+#define HOT_LOG_DBG(...) LOG_DBG(__VA_ARGS__)
+#define HOT_LOG_INF(...) LOG_INF(__VA_ARGS__)
+#else
+#define HOT_LOG_DBG(...)			\
+	do {					\
+		if (0) {			\
+			LOG_DBG(__VA_ARGS__);	\
+		}				\
+	} while (false)
+#define HOT_LOG_INF(...)			\
+	do {					\
+		if (0) {			\
+			LOG_INF(__VA_ARGS__);	\
+		}				\
+	} while (false)
+#endif
+
+#endif
+
+/**
+ * @}
+ */
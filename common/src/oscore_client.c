@@ -0,0 +1,591 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <errno.h>
+#include <string.h>
+
+#include <oscore.h>
+
+#include "oscore_client.h"
+
+LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
+
+#define OSCORE_SETTINGS_KEY CONFIG_COAP_CLIENT_OSCORE_SETTINGS_KEY
+
+/* AES-CCM-16-64-128 has a 13 byte nonce, leaving 7 bytes for an id */
+#define OSCORE_ID_MAX 7
+#define OSCORE_ID_CONTEXT_MAX 8
+#define OSCORE_SECRET_MAX 32
+/* Matches the AES-CCM-16-64-128 key */
+#define OSCORE_SECRET_MIN 16
+
+BUILD_ASSERT(sizeof(CONFIG_COAP_CLIENT_OSCORE_MASTER_SECRET) >
+	     2 * OSCORE_SECRET_MIN,
+	     "Set CONFIG_COAP_CLIENT_OSCORE_MASTER_SECRET for this deployment");
+
+/* Same timing as the confirmable requests through the OpenThread service */
+#define ACK_TIMEOUT_MS 2000
+#define MAX_RETRANSMIT 2
+/* A non-confirmable exchange waits as long as a confirmable one would */
+#define NON_LIFETIME_MS (ACK_TIMEOUT_MS * ((2 << MAX_RETRANSMIT) - 1))
+
+#define RX_THREAD_PRIORITY K_PRIO_PREEMPT(8)
+
+/* Identifiers assigned at provisioning, stored as one blob */
+struct oscore_ids {
+	uint8_t sender_id[OSCORE_ID_MAX];
+	uint8_t recipient_id[OSCORE_ID_MAX];
+	uint8_t id_context[OSCORE_ID_CONTEXT_MAX];
+	uint8_t sender_id_len;
+	uint8_t recipient_id_len;
+	uint8_t id_context_len;
+};
+
+/* A request waiting for its ACK or response */
+struct exchange {
+	struct k_work_delayable timer;
+	struct coap_reply reply;
+	struct sockaddr_in6 addr;
+	int64_t sent_ms;
+	uint32_t timeout_ms;
+	uint16_t id;
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl;
+	uint8_t retries;
+	bool confirmable;
+	bool acked;
+	bool in_use;
+	uint16_t len;
+	uint8_t data[CONFIG_COAP_CLIENT_OSCORE_BUF_SIZE];
+};
+
+static K_MUTEX_DEFINE(lock);
+static K_THREAD_STACK_DEFINE(rx_stack, CONFIG_COAP_CLIENT_OSCORE_RX_STACK_SIZE);
+static struct k_thread rx_thread_data;
+static int sock = -1;
+
+static struct exchange exchanges[CONFIG_COAP_CLIENT_OSCORE_EXCHANGES];
+static struct oscore_client_stats stats;
+
+/* uOSCORE keeps pointers to the inputs, they must outlive the context */
+static uint8_t master_secret[OSCORE_SECRET_MAX];
+static uint8_t master_salt[OSCORE_SECRET_MAX];
+static size_t master_secret_len;
+static size_t master_salt_len;
+static uint8_t id_context[OSCORE_ID_CONTEXT_MAX + sizeof(uint32_t)];
+
+static struct oscore_ids ids;
+static bool have_ids;
+static uint32_t generation;	/* Contexts derived so far, stored */
+static struct context ctx;
+static bool ready;
+
+/* Working buffers, used with the lock held */
+static uint8_t plain_buf[CONFIG_COAP_CLIENT_OSCORE_BUF_SIZE];
+static uint8_t protected_buf[CONFIG_COAP_CLIENT_OSCORE_BUF_SIZE];
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int oscore_settings_set(const char *name, size_t len,
+			       settings_read_cb read_cb, void *cb_arg)
+{
+	int ret;
+
+	if (!strcmp(name, "ids") && len == sizeof(ids)) {
+		ret = read_cb(cb_arg, &ids, sizeof(ids));
+		have_ids = ret == sizeof(ids) &&
+			   ids.sender_id_len <= OSCORE_ID_MAX &&
+			   ids.recipient_id_len <= OSCORE_ID_MAX &&
+			   ids.id_context_len <= OSCORE_ID_CONTEXT_MAX;
+	} else if (!strcmp(name, "gen") && len == sizeof(generation)) {
+		ret = read_cb(cb_arg, &generation, sizeof(generation));
+	} else {
+		return -EINVAL;
+	}
+
+	return ret < 0 ? ret : 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(oscore, OSCORE_SETTINGS_KEY, NULL,
+			       oscore_settings_set, NULL, NULL);
+#endif
+
+static int store(const char *name, const void *value, size_t len)
+{
+#if IS_ENABLED(CONFIG_SETTINGS)
+	char key[sizeof(OSCORE_SETTINGS_KEY) + 4];
+
+	snprintk(key, sizeof(key), OSCORE_SETTINGS_KEY "/%s", name);
+
+	return settings_save_one(key, value, len);
+#else
+	return -ENOTSUP;
+#endif
+}
+
+/* Derive a context under an ID context not used before. uOSCORE starts
+ * the sender sequence number over on every derivation, the generation
+ * appended to the provisioned ID context keeps the nonces unique.
+ */
+static int derive(void)
+{
+	uint32_t next = generation + 1;
+	enum err err;
+	int ret;
+
+	/* Stored before the context is used, a lost generation would
+	 * reuse nonces after the next reboot
+	 */
+	ret = store("gen", &next, sizeof(next));
+	if (ret) {
+		LOG_ERR("Cannot store OSCORE generation, (error: %d)", ret);
+		ready = false;
+		return -EIO;
+	}
+	generation = next;
+
+	memcpy(id_context, ids.id_context, ids.id_context_len);
+	sys_put_be32(generation, &id_context[ids.id_context_len]);
+
+	struct oscore_init_params params = {
+		.master_secret = { .ptr = master_secret,
+				   .len = master_secret_len },
+		.sender_id = { .ptr = ids.sender_id,
+			       .len = ids.sender_id_len },
+		.recipient_id = { .ptr = ids.recipient_id,
+				  .len = ids.recipient_id_len },
+		.id_context = { .ptr = id_context,
+				.len = ids.id_context_len + sizeof(uint32_t) },
+		.master_salt = { .ptr = master_salt, .len = master_salt_len },
+		.aead_alg = OSCORE_AES_CCM_16_64_128,
+		.hkdf = OSCORE_SHA_256,
+	};
+
+	err = oscore_context_init(&params, &ctx);
+	ready = err == ok;
+	if (!ready) {
+		LOG_ERR("Cannot derive OSCORE context: %d", err);
+		return -EIO;
+	}
+
+	LOG_INF("OSCORE context derived, generation %u", generation);
+
+	return 0;
+}
+
+static int parse_id(const char *hex, uint8_t *buf, size_t max, uint8_t *len)
+{
+	size_t hex_len = strlen(hex);
+
+	/* Empty identifiers are valid */
+	if (hex_len % 2 || hex_len / 2 > max) {
+		return -EINVAL;
+	}
+	if (hex_len && hex2bin(hex, hex_len, buf, max) != hex_len / 2) {
+		return -EINVAL;
+	}
+
+	*len = hex_len / 2;
+
+	return 0;
+}
+
+/* Call the reply handler and free the exchange, with the lock held */
+static void finish(struct exchange *ex, const struct coap_packet *response)
+{
+	k_work_cancel_delayable(&ex->timer);
+	ex->in_use = false;
+
+	/* Non-confirmable requests fail silently, like with coap_utils */
+	if (ex->reply.reply && (response || ex->confirmable)) {
+		ex->reply.reply(response, &ex->reply,
+				(const struct sockaddr *)&ex->addr);
+	}
+}
+
+static void exchange_timeout(struct k_work *item)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(item);
+	struct exchange *ex = CONTAINER_OF(dwork, struct exchange, timer);
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	if (!ex->in_use) {
+		goto unlock;
+	}
+
+	if (ex->confirmable && !ex->acked && ex->retries < MAX_RETRANSMIT) {
+		/* The protected message is resent as is, with its Partial IV */
+		ex->retries++;
+		ex->timeout_ms *= 2;
+		zsock_sendto(sock, ex->data, ex->len, 0,
+			     (const struct sockaddr *)&ex->addr,
+			     sizeof(ex->addr));
+		k_work_reschedule(&ex->timer, K_MSEC(ex->timeout_ms));
+		goto unlock;
+	}
+
+	if (ex->confirmable && !ex->acked) {
+		stats.timeouts++;
+	}
+	finish(ex, NULL);
+
+unlock:
+	k_mutex_unlock(&lock);
+}
+
+static struct exchange *find_exchange(const struct coap_packet *packet)
+{
+	uint8_t token[COAP_TOKEN_MAX_LEN];
+	uint8_t tkl = coap_header_get_token(packet, token);
+	uint16_t id = coap_header_get_id(packet);
+	bool empty = coap_header_get_code(packet) == COAP_CODE_EMPTY;
+
+	for (int i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		struct exchange *ex = &exchanges[i];
+
+		if (!ex->in_use) {
+			continue;
+		}
+
+		/* Empty ACKs and resets only carry the message id */
+		if (empty ? ex->id == id :
+		    ex->tkl == tkl && !memcmp(ex->token, token, tkl)) {
+			return ex;
+		}
+	}
+
+	return NULL;
+}
+
+static void send_empty_ack(uint16_t id, const struct sockaddr_in6 *to)
+{
+	uint8_t ack[4] = { 0x60, COAP_CODE_EMPTY, id >> 8, id & 0xff };
+
+	zsock_sendto(sock, ack, sizeof(ack), 0, (const struct sockaddr *)to,
+		     sizeof(*to));
+}
+
+static void handle_datagram(uint8_t *buf, size_t len,
+			    const struct sockaddr_in6 *from)
+{
+	struct coap_packet outer;
+	struct coap_packet response;
+	struct exchange *ex;
+	uint32_t plain_len = sizeof(plain_buf);
+	bool is_oscore = false;
+	uint32_t start;
+	uint32_t rtt;
+	enum err err;
+	uint8_t type;
+
+	if (coap_packet_parse(&outer, buf, len, NULL, 0) < 0) {
+		return;
+	}
+
+	type = coap_header_get_type(&outer);
+	if (type == COAP_TYPE_CON) {
+		/* Separate response */
+		send_empty_ack(coap_header_get_id(&outer), from);
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	ex = find_exchange(&outer);
+	if (!ex) {
+		goto unlock;
+	}
+
+	if (coap_header_get_code(&outer) == COAP_CODE_EMPTY) {
+		if (type == COAP_TYPE_RESET) {
+			finish(ex, NULL);
+		} else if (type == COAP_TYPE_ACK && !ex->acked) {
+			/* The response follows on its own, stop resending */
+			ex->acked = true;
+			k_work_reschedule(&ex->timer, K_MSEC(NON_LIFETIME_MS));
+		}
+		goto unlock;
+	}
+
+	start = k_cycle_get_32();
+	err = oscore2coap(buf, len, plain_buf, &plain_len, &is_oscore, &ctx);
+	stats.unprotect_us += k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+	if (err != ok || !is_oscore ||
+	    coap_packet_parse(&response, plain_buf, plain_len, NULL, 0) < 0) {
+		LOG_WRN("Response failed OSCORE verification: %d", err);
+		stats.rejected++;
+		finish(ex, NULL);
+		goto unlock;
+	}
+
+	stats.responses++;
+	rtt = k_uptime_get() - ex->sent_ms;
+	stats.rtt_ms += rtt;
+	stats.rtt_max_ms = MAX(stats.rtt_max_ms, rtt);
+
+	finish(ex, &response);
+
+unlock:
+	k_mutex_unlock(&lock);
+}
+
+static void rx_thread(void *p1, void *p2, void *p3)
+{
+	static uint8_t buf[CONFIG_COAP_CLIENT_OSCORE_BUF_SIZE];
+	struct sockaddr_in6 from;
+	socklen_t from_len;
+	ssize_t len;
+
+	ARG_UNUSED(p1);
+	ARG_UNUSED(p2);
+	ARG_UNUSED(p3);
+
+	while (true) {
+		from_len = sizeof(from);
+		len = zsock_recvfrom(sock, buf, sizeof(buf), 0,
+				     (struct sockaddr *)&from, &from_len);
+		if (len < 0) {
+			LOG_ERR("OSCORE receive failed, (error: %d)", errno);
+			k_sleep(K_SECONDS(1));
+			continue;
+		}
+
+		handle_datagram(buf, len, &from);
+	}
+}
+
+int oscore_client_init(void)
+{
+	const char *secret = CONFIG_COAP_CLIENT_OSCORE_MASTER_SECRET;
+	const char *salt = CONFIG_COAP_CLIENT_OSCORE_MASTER_SALT;
+
+	master_secret_len = hex2bin(secret, strlen(secret), master_secret,
+				    sizeof(master_secret));
+	master_salt_len = hex2bin(salt, strlen(salt), master_salt,
+				  sizeof(master_salt));
+	if (!master_secret_len || (strlen(salt) && !master_salt_len)) {
+		LOG_ERR("OSCORE master secret or salt is not valid hex");
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(exchanges); i++) {
+		k_work_init_delayable(&exchanges[i].timer, exchange_timeout);
+	}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	int ret = settings_subsys_init();
+
+	if (!ret) {
+		ret = settings_load_subtree(OSCORE_SETTINGS_KEY);
+	}
+	if (ret) {
+		LOG_ERR("Cannot load OSCORE context, (error: %d)", ret);
+	}
+#endif
+
+	sock = zsock_socket(AF_INET6, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock < 0) {
+		LOG_ERR("Cannot create OSCORE socket, (error: %d)", errno);
+		return -errno;
+	}
+
+	k_thread_create(&rx_thread_data, rx_stack,
+			K_THREAD_STACK_SIZEOF(rx_stack), rx_thread, NULL, NULL,
+			NULL, RX_THREAD_PRIORITY, 0, K_NO_WAIT);
+	k_thread_name_set(&rx_thread_data, "oscore_rx");
+
+	if (have_ids) {
+		k_mutex_lock(&lock, K_FOREVER);
+		derive();
+		k_mutex_unlock(&lock);
+	}
+
+	return 0;
+}
+
+int oscore_client_provision(const char *value)
+{
+	struct oscore_ids next = { 0 };
+	char text[2 * (2 * OSCORE_ID_MAX + OSCORE_ID_CONTEXT_MAX) + 3];
+	char *fields[3] = { NULL };
+	char *sep;
+	int ret = 0;
+
+	if (strlen(value) >= sizeof(text)) {
+		return -EINVAL;
+	}
+	strcpy(text, value);
+
+	/* strtok_r would skip the empty identifiers */
+	fields[0] = text;
+	for (int i = 1; i < ARRAY_SIZE(fields); i++) {
+		sep = strchr(fields[i - 1], ',');
+		if (!sep) {
+			break;
+		}
+		*sep = '\0';
+		fields[i] = sep + 1;
+	}
+
+	if (!fields[1] ||
+	    parse_id(fields[0], next.sender_id, OSCORE_ID_MAX,
+		     &next.sender_id_len) ||
+	    parse_id(fields[1], next.recipient_id, OSCORE_ID_MAX,
+		     &next.recipient_id_len) ||
+	    (fields[2] && parse_id(fields[2], next.id_context,
+				   OSCORE_ID_CONTEXT_MAX,
+				   &next.id_context_len))) {
+		LOG_WRN("Malformed OSCORE identifiers: %s", value);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	/* Re-provisioning after a failover keeps the running context */
+	if (ready && !memcmp(&next, &ids, sizeof(ids))) {
+		goto unlock;
+	}
+
+	ids = next;
+	have_ids = true;
+	ret = derive();
+	if (!ret) {
+		ret = store("ids", &ids, sizeof(ids));
+		if (ret) {
+			LOG_WRN("Cannot store OSCORE identifiers, (error: %d)",
+				ret);
+			ret = 0;
+		}
+	}
+
+unlock:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+bool oscore_client_is_ready(void)
+{
+	return ready;
+}
+
+int oscore_client_send(bool confirmable, enum coap_method method,
+		       const struct sockaddr_in6 *addr,
+		       const char *const *path, const uint8_t *payload,
+		       size_t len, coap_reply_t reply)
+{
+	struct coap_packet request;
+	struct exchange *ex = NULL;
+	uint32_t protected_len = sizeof(protected_buf);
+	uint32_t start;
+	enum err err;
+	int ret;
+
+	if (!ready) {
+		return -ENOTCONN;
+	}
+
+	k_mutex_lock(&lock, K_FOREVER);
+
+	/* Fire and forget requests don't hold an exchange */
+	if (confirmable || reply) {
+		for (int i = 0; i < ARRAY_SIZE(exchanges); i++) {
+			if (!exchanges[i].in_use) {
+				ex = &exchanges[i];
+				break;
+			}
+		}
+		if (!ex) {
+			ret = -EAGAIN;
+			goto unlock;
+		}
+	}
+
+	ret = coap_packet_init(&request, plain_buf, sizeof(plain_buf),
+			       COAP_VERSION_1,
+			       confirmable ? COAP_TYPE_CON : COAP_TYPE_NON_CON,
+			       COAP_TOKEN_MAX_LEN, coap_next_token(), method,
+			       coap_next_id());
+	for (int i = 0; !ret && path[i]; i++) {
+		ret = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+						(const uint8_t *)path[i],
+						strlen(path[i]));
+	}
+	if (!ret && len) {
+		ret = coap_append_option_int(&request,
+					     COAP_OPTION_CONTENT_FORMAT,
+					     COAP_CONTENT_FORMAT_TEXT_PLAIN);
+	}
+	if (!ret && len) {
+		ret = coap_packet_append_payload_marker(&request);
+	}
+	if (!ret && len) {
+		ret = coap_packet_append_payload(&request, payload, len);
+	}
+	if (ret) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	start = k_cycle_get_32();
+	err = coap2oscore(plain_buf, request.offset, protected_buf,
+			  &protected_len, &ctx);
+	stats.protect_us += k_cyc_to_us_floor32(k_cycle_get_32() - start);
+	if (err != ok) {
+		LOG_ERR("Cannot protect request: %d", err);
+		ret = -EIO;
+		goto unlock;
+	}
+
+	if (zsock_sendto(sock, protected_buf, protected_len, 0,
+			 (const struct sockaddr *)addr, sizeof(*addr)) < 0) {
+		LOG_ERR("Cannot send protected request, (error: %d)", errno);
+		ret = -EIO;
+		goto unlock;
+	}
+
+	stats.requests++;
+	stats.plain_bytes += request.offset;
+	stats.protected_bytes += protected_len;
+
+	if (ex) {
+		ex->in_use = true;
+		ex->addr = *addr;
+		ex->reply.reply = reply;
+		ex->tkl = coap_header_get_token(&request, ex->token);
+		ex->id = coap_header_get_id(&request);
+		ex->confirmable = confirmable;
+		ex->acked = false;
+		ex->retries = 0;
+		ex->timeout_ms = ACK_TIMEOUT_MS;
+		ex->sent_ms = k_uptime_get();
+		ex->len = protected_len;
+		memcpy(ex->data, protected_buf, protected_len);
+		k_work_reschedule(&ex->timer, K_MSEC(confirmable ?
+						      ACK_TIMEOUT_MS :
+						      NON_LIFETIME_MS));
+	}
+
+unlock:
+	k_mutex_unlock(&lock);
+
+	return ret;
+}
+
+void oscore_client_get_stats(struct oscore_client_stats *out)
+{
+	k_mutex_lock(&lock, K_FOREVER);
+	*out = stats;
+	k_mutex_unlock(&lock);
+}
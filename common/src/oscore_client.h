@@ -0,0 +1,99 @@
+/**
+ * @file
+ * @defgroup oscore_client OSCORE protected CoAP requests
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __OSCORE_CLIENT_H__
+#define __OSCORE_CLIENT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include <zephyr/net/coap.h>
+#include <zephyr/net/socket.h>
+
+struct oscore_client_stats {
+	uint32_t requests;	/* Protected requests sent, retransmissions excluded */
+	uint32_t responses;	/* Responses verified and decrypted */
+	uint32_t rejected;	/* Responses failing verification */
+	uint32_t timeouts;	/* Confirmable requests never acknowledged */
+	uint32_t plain_bytes;	/* CoAP request bytes before protection */
+	uint32_t protected_bytes; /* Request bytes on the wire */
+	uint32_t protect_us;	/* Time spent protecting requests */
+	uint32_t unprotect_us;	/* Time spent verifying responses */
+	uint32_t rtt_ms;	/* Request to response time, summed */
+	uint32_t rtt_max_ms;	/* Slowest response */
+};
+
+/** @brief Load the stored security context and start the receiver.
+ *
+ * A context stored by an earlier provisioning is derived again under a
+ * new ID context, so the sender sequence numbers starting over don't
+ * reuse a nonce.
+ *
+ * @retval 0 On success, also without a stored context.
+ * @retval -EINVAL The master secret or salt is not valid hex.
+ */
+int oscore_client_init(void);
+
+/** @brief Apply the "oscore" provisioning option.
+ *
+ * Derives a new security context, unless the identifiers are the ones
+ * in use already, and stores the identifiers.
+ *
+ * @param[in] value "<sender id>,<recipient id>[,<id context>]" in hex.
+ *
+ * @retval 0 On success.
+ * @retval -EINVAL Malformed or too long identifiers.
+ * @retval -EIO The context derivation failed.
+ */
+int oscore_client_provision(const char *value);
+
+/** @brief Check whether a security context is available.
+ */
+bool oscore_client_is_ready(void);
+
+/** @brief Send an OSCORE protected request.
+ *
+ * The method and Uri-Path travel encrypted, the outer message is a POST
+ * for requests that are not a FETCH. Non-confirmable requests are sent
+ * once. Confirmable ones are retransmitted until acknowledged, @p reply
+ * is called with a NULL response when none arrives or it fails
+ * verification.
+ *
+ * @param[in] confirmable Send as a confirmable message.
+ * @param[in] method      CoAP method.
+ * @param[in] addr        Server address.
+ * @param[in] path        NULL terminated Uri-Path segments.
+ * @param[in] payload     Plain text payload. May be NULL if len is 0.
+ * @param[in] len         Length of the payload.
+ * @param[in] reply       Called with the decrypted response, may be NULL.
+ *
+ * @retval 0 On success.
+ * @retval -ENOTCONN No security context yet.
+ * @retval -EAGAIN All exchanges are in use.
+ * @retval -ENOMEM The request does not fit the buffer.
+ * @retval -EIO Protecting or sending failed.
+ */
+int oscore_client_send(bool confirmable, enum coap_method method,
+		       const struct sockaddr_in6 *addr,
+		       const char *const *path, const uint8_t *payload,
+		       size_t len, coap_reply_t reply);
+
+/** @brief Get the protection and round trip counters.
+ */
+void oscore_client_get_stats(struct oscore_client_stats *stats);
+
+#endif
+
+/**
+ * @}
+ */
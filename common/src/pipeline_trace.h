@@ -0,0 +1,58 @@
+/**
+ * @file
+ * @defgroup pipeline_trace Pipeline stage tracing
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __PIPELINE_TRACE_H__
+#define __PIPELINE_TRACE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Stages of a sensor reading or a heater target poll from the RTC tick
+ * to the radio, and of a setpoint change to the heater output, in the
+ * order they are passed. heater_client/scripts/pipeline_latency.py pairs
+ * every stage with the one before it.
+ */
+#define TRACE_RTC_TICK		"rtc_tick"	/* Scheduler alarm, in the ISR */
+#define TRACE_JOB_RUN		"job_run"	/* Job run by the workqueue */
+#define TRACE_I2C_START		"i2c_start"	/* Sensor read started */
+#define TRACE_I2C_DONE		"i2c_done"	/* Sensor read finished */
+#define TRACE_TX_PUSH		"tx_push"	/* Request queued */
+#define TRACE_TX_SEND		"tx_send"	/* Request taken off the queue */
+#define TRACE_COAP_SEND		"coap_send"	/* Handed to CoAP */
+#define TRACE_COAP_SENT		"coap_sent"	/* Back from CoAP, in the stack */
+#define TRACE_RADIO_TX		"radio_tx"	/* Frame transmission started */
+#define TRACE_RADIO_DONE	"radio_done"	/* Frame transmitted or failed */
+#define TRACE_COAP_REPLY	"coap_reply"	/* Targets received */
+#define TRACE_SETPOINT		"setpoint"	/* Setpoint changed */
+#define TRACE_CTRL_WAKE		"ctrl_wake"	/* Control loop woke up */
+#define TRACE_TEMP_START	"temp_start"	/* Thermocouple read started */
+#define TRACE_TEMP_DONE		"temp_done"	/* Thermocouple read finished */
+#define TRACE_ACTUATE		"actuate"	/* Heater duty applied */
+
+#if defined(CONFIG_COAP_CLIENT_PIPELINE_TRACE)
+#include <zephyr/tracing/tracing.h>
+
+#define PIPELINE_TRACE(stage, arg0, arg1) \
+	sys_trace_named_event(stage, (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define PIPELINE_TRACE(stage, arg0, arg1)	\
+	do {					\
+		(void)(arg0);			\
+		(void)(arg1);			\
+	} while (false)
+#endif
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,45 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <openthread/platform/radio.h>
+
+#include "pipeline_trace.h"
+
+/* 802.15.4 frame type, in the low bits of the frame control field */
+#define FRAME_TYPE_MASK 0x07
+#define FRAME_TYPE_DATA 0x01
+
+/* Provided by the samples that select CONFIG_COAP_CLIENT_DATA_FRAME_HOOK */
+void coap_client_data_frame_sent(void);
+
+/* The radio driver reports every frame to OpenThread through these
+ * callbacks. The build links them with --wrap, so the frames show up in
+ * the trace next to the pipeline stages, and the sample can act on the
+ * data frames it sent.
+ */
+void __real_otPlatRadioTxStarted(otInstance *aInstance, otRadioFrame *aFrame);
+void __real_otPlatRadioTxDone(otInstance *aInstance, otRadioFrame *aFrame,
+			      otRadioFrame *aAckFrame, otError aError);
+
+void __wrap_otPlatRadioTxStarted(otInstance *aInstance, otRadioFrame *aFrame)
+{
+	PIPELINE_TRACE(TRACE_RADIO_TX, aFrame->mLength, aFrame->mChannel);
+	__real_otPlatRadioTxStarted(aInstance, aFrame);
+}
+
+void __wrap_otPlatRadioTxDone(otInstance *aInstance, otRadioFrame *aFrame,
+			      otRadioFrame *aAckFrame, otError aError)
+{
+	bool data = (aFrame->mPsdu[0] & FRAME_TYPE_MASK) == FRAME_TYPE_DATA;
+
+	PIPELINE_TRACE(TRACE_RADIO_DONE, aFrame->mLength, aError);
+	__real_otPlatRadioTxDone(aInstance, aFrame, aAckFrame, aError);
+
+	if (IS_ENABLED(CONFIG_COAP_CLIENT_DATA_FRAME_HOOK) && data) {
+		coap_client_data_frame_sent();
+	}
+}
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/counter.h>
+#include <zephyr/logging/log.h>
+
+#include "pipeline_trace.h"
+#include "scheduler.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define ALARM_CHANNEL 0
+
+#define TICK_MS CONFIG_SCHEDULER_TICK_MS
+#define SLOTS CONFIG_SCHEDULER_SLOTS
+
+static const struct device *rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc2));
+
+/* Jobs are filed in the slot of the tick they fall due in. A slot can hold
+ * jobs from later revolutions too, they are skipped until their tick comes.
+ */
+static sys_slist_t wheel[SLOTS];
+static int64_t wheel_tick;	/* Oldest tick that may still hold due jobs */
+static int64_t armed_ms = INT64_MAX;
+static struct k_spinlock lock;
+static struct k_work run_work;
+
+static void file_locked(struct scheduler_job *job)
+{
+	/* Late jobs go to the current tick, so the next run picks them up */
+	job->tick = MAX(job->due_ms / TICK_MS, wheel_tick);
+	job->scheduled = true;
+	sys_slist_append(&wheel[job->tick % SLOTS], &job->node);
+}
+
+static void unfile_locked(struct scheduler_job *job)
+{
+	if (job->scheduled) {
+		sys_slist_find_and_remove(&wheel[job->tick % SLOTS], &job->node);
+		job->scheduled = false;
+	}
+}
+
+static int64_t next_due_locked(void)
+{
+	struct scheduler_job *job;
+	int64_t next = INT64_MAX;
+
+	/* The first occupied tick holds the earliest job */
+	for (int64_t tick = wheel_tick; tick < wheel_tick + SLOTS; tick++) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&wheel[tick % SLOTS], job, node) {
+			if (job->tick == tick) {
+				next = MIN(next, job->due_ms);
+			}
+		}
+
+		if (next != INT64_MAX) {
+			return next;
+		}
+	}
+
+	/* Nothing within one revolution, look at all jobs */
+	for (int i = 0; i < SLOTS; i++) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&wheel[i], job, node) {
+			next = MIN(next, job->due_ms);
+		}
+	}
+
+	return next;
+}
+
+static void on_alarm(const struct device *dev, uint8_t chan_id,
+		     uint32_t ticks, void *user_data)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(chan_id);
+	ARG_UNUSED(user_data);
+
+	PIPELINE_TRACE(TRACE_RTC_TICK, ticks, 0);
+
+	armed_ms = INT64_MAX;
+	k_work_submit(&run_work);
+}
+
+/* Program the single hardware alarm for the earliest job */
+static void arm_locked(int64_t now)
+{
+	struct counter_alarm_cfg alarm = {
+		.callback = on_alarm,
+	};
+	int64_t next = next_due_locked();
+	uint64_t delay_us;
+	int ret;
+
+	if (next == armed_ms) {
+		return;
+	}
+
+	counter_cancel_channel_alarm(rtc_dev, ALARM_CHANNEL);
+	armed_ms = next;
+
+	if (next == INT64_MAX) {
+		return;
+	}
+
+	/* A delay beyond the counter range wakes up early and re-arms */
+	delay_us = MAX(next - now, 1) * USEC_PER_MSEC;
+	alarm.ticks = MIN(counter_us_to_ticks(rtc_dev, delay_us),
+			  counter_get_top_value(rtc_dev) / 2);
+
+	ret = counter_set_channel_alarm(rtc_dev, ALARM_CHANNEL, &alarm);
+	if (ret) {
+		LOG_ERR("Cannot set scheduler alarm (error: %d)", ret);
+		armed_ms = INT64_MAX;
+	}
+}
+
+/* Take the first job due before the horizon off the wheel */
+static struct scheduler_job *pop_due_locked(int64_t horizon)
+{
+	struct scheduler_job *job;
+	int64_t last = horizon / TICK_MS;
+
+	for (; wheel_tick <= last; wheel_tick++) {
+		SYS_SLIST_FOR_EACH_CONTAINER(&wheel[wheel_tick % SLOTS], job,
+					     node) {
+			if (job->tick == wheel_tick && job->due_ms <= horizon) {
+				unfile_locked(job);
+				return job;
+			}
+		}
+
+		/* The horizon tick may still hold later jobs */
+		if (wheel_tick == last) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void run_due_jobs(struct k_work *item)
+{
+	struct scheduler_job *job;
+	k_spinlock_key_t key;
+	int64_t late_ms;
+	int64_t now;
+
+	ARG_UNUSED(item);
+
+	for (;;) {
+		key = k_spin_lock(&lock);
+		now = k_uptime_get();
+
+		/* Jobs due shortly after share this wake-up */
+		job = pop_due_locked(now + CONFIG_SCHEDULER_COALESCE_MS);
+		if (job == NULL) {
+			break;
+		}
+
+		late_ms = MAX(now - job->due_ms, 0);
+
+		if (job->period_ms) {
+			/* Skip runs missed while the workqueue was busy */
+			job->due_ms += job->period_ms *
+				       (late_ms / job->period_ms + 1);
+			file_locked(job);
+		}
+
+		k_spin_unlock(&lock, key);
+
+		PIPELINE_TRACE(TRACE_JOB_RUN, (uintptr_t)job, late_ms);
+		job->handler(job);
+	}
+
+	arm_locked(now);
+	k_spin_unlock(&lock, key);
+}
+
+static void schedule(struct scheduler_job *job, int64_t due_ms,
+		     uint32_t period_ms)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	unfile_locked(job);
+	job->due_ms = due_ms;
+	job->period_ms = period_ms;
+	file_locked(job);
+	arm_locked(k_uptime_get());
+
+	k_spin_unlock(&lock, key);
+}
+
+void scheduler_job_init(struct scheduler_job *job, scheduler_handler_t handler)
+{
+	job->handler = handler;
+	job->scheduled = false;
+}
+
+int scheduler_job_periodic(struct scheduler_job *job, uint32_t period_ms,
+			   uint32_t phase_ms)
+{
+	int64_t now = k_uptime_get();
+	int64_t offset;
+
+	/* A shorter period would be run again within its own wake-up */
+	if (period_ms <= CONFIG_SCHEDULER_COALESCE_MS) {
+		return -EINVAL;
+	}
+
+	/* Time since the last aligned run, the next one is a period later */
+	offset = ((now - phase_ms) % period_ms + period_ms) % period_ms;
+	schedule(job, now - offset + period_ms, period_ms);
+
+	return 0;
+}
+
+void scheduler_job_once(struct scheduler_job *job, uint32_t delay_ms)
+{
+	schedule(job, k_uptime_get() + delay_ms, 0);
+}
+
+void scheduler_job_cancel(struct scheduler_job *job)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	unfile_locked(job);
+	arm_locked(k_uptime_get());
+
+	k_spin_unlock(&lock, key);
+}
+
+int scheduler_init(void)
+{
+	int ret;
+
+	if (!device_is_ready(rtc_dev)) {
+		return -ENODEV;
+	}
+
+	k_work_init(&run_work, run_due_jobs);
+
+	for (int i = 0; i < SLOTS; i++) {
+		sys_slist_init(&wheel[i]);
+	}
+	wheel_tick = k_uptime_get() / TICK_MS;
+
+	ret = counter_start(rtc_dev);
+	if (ret && ret != -EALREADY) {
+		return ret;
+	}
+
+	return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file
+ * @defgroup scheduler Timer wheel job scheduler
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/slist.h>
+
+struct scheduler_job;
+
+/** @brief Job handler, called from the system workqueue. */
+typedef void (*scheduler_handler_t)(struct scheduler_job *job);
+
+/** @brief Periodic or one-shot job.
+ *
+ * Embed it in a larger structure and use CONTAINER_OF() in the handler
+ * to reach the job's own data. All fields are private to the scheduler.
+ */
+struct scheduler_job {
+	sys_snode_t node;
+	scheduler_handler_t handler;
+	int64_t due_ms;
+	int64_t tick;
+	uint32_t period_ms;
+	bool scheduled;
+};
+
+/** @brief Set up the hardware alarm the scheduler runs from.
+ *
+ * @retval 0    On success.
+ * @retval != 0 On failure.
+ */
+int scheduler_init(void);
+
+/** @brief Initialize a job.
+ *
+ * @param job     Job to initialize.
+ * @param handler Handler to call each time the job is due.
+ */
+void scheduler_job_init(struct scheduler_job *job, scheduler_handler_t handler);
+
+/** @brief Run a job periodically.
+ *
+ * Runs are aligned to multiples of the period since boot, shifted by the
+ * phase. Jobs with the same period and phase therefore share a wake-up,
+ * while different phases spread jobs of the same period apart. A job
+ * that is already scheduled is moved to the new timing.
+ *
+ * @param job       Initialized job.
+ * @param period_ms Period between runs.
+ * @param phase_ms  Offset of the runs within the period.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL The period is not longer than the coalescing window.
+ */
+int scheduler_job_periodic(struct scheduler_job *job, uint32_t period_ms,
+			   uint32_t phase_ms);
+
+/** @brief Run a job once.
+ *
+ * @param job      Initialized job.
+ * @param delay_ms Delay before the run.
+ */
+void scheduler_job_once(struct scheduler_job *job, uint32_t delay_ms);
+
+/** @brief Stop a job. Does nothing if the job is not scheduled.
+ *
+ * @param job Job to stop.
+ */
+void scheduler_job_cancel(struct scheduler_job *job);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,227 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <string.h>
+
+#include "pipeline_trace.h"
+#include "tx_queue.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+struct tx_entry {
+	uint32_t seq;		/* Order of arrival, 0 marks a free entry */
+	uint8_t kind;
+	uint8_t prio;
+	bool coalesce;
+	uint8_t len;
+	uint8_t payload[CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD];
+};
+
+static struct tx_entry entries[CONFIG_COAP_CLIENT_TX_QUEUE_SIZE];
+static struct tx_queue_stats stats;
+static struct k_spinlock lock;
+static uint32_t next_seq = 1;
+static bool connected;
+static tx_queue_send_t send_entry;
+static struct k_work_delayable drain_work;
+
+/* Next entry to send: highest priority, then oldest */
+static struct tx_entry *head(void)
+{
+	struct tx_entry *best = NULL;
+
+	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
+		struct tx_entry *entry = &entries[i];
+
+		if (entry->seq && (!best || entry->prio < best->prio ||
+				   (entry->prio == best->prio &&
+				    entry->seq < best->seq))) {
+			best = entry;
+		}
+	}
+
+	return best;
+}
+
+/* Entry to give up when full: lowest priority, then oldest */
+static struct tx_entry *victim(void)
+{
+	struct tx_entry *worst = NULL;
+
+	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
+		struct tx_entry *entry = &entries[i];
+
+		if (!worst || entry->prio > worst->prio ||
+		    (entry->prio == worst->prio && entry->seq < worst->seq)) {
+			worst = entry;
+		}
+	}
+
+	return worst;
+}
+
+static struct tx_entry *find_slot(uint8_t kind, uint8_t prio, bool coalesce)
+{
+	struct tx_entry *entry;
+
+	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
+		entry = &entries[i];
+
+		if (coalesce && entry->seq && entry->coalesce &&
+		    entry->kind == kind) {
+			stats.coalesced++;
+			/* Promote it if the newer one is more urgent */
+			entry->prio = MIN(entry->prio, prio);
+			return entry;
+		}
+	}
+
+	entry = NULL;
+	for (int i = 0; i < ARRAY_SIZE(entries); i++) {
+		if (!entries[i].seq) {
+			entry = &entries[i];
+			stats.queued++;
+			break;
+		}
+	}
+
+	if (!entry) {
+		entry = victim();
+		if (entry->prio < prio) {
+			return NULL;
+		}
+
+		LOG_DBG("TX queue full, dropping entry of kind %d",
+			entry->kind);
+		stats.dropped++;
+	}
+
+	entry->seq = next_seq++;
+	entry->prio = prio;
+
+	return entry;
+}
+
+static void drain(struct k_work *item)
+{
+	uint8_t payload[CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD];
+	struct tx_entry *entry;
+	struct tx_entry *next;
+	k_timeout_t pause;
+	bool more = false;
+	uint8_t kind;
+	size_t len;
+
+	ARG_UNUSED(item);
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	entry = connected ? head() : NULL;
+	if (entry) {
+		kind = entry->kind;
+		len = entry->len;
+		memcpy(payload, entry->payload, len);
+
+		entry->seq = 0;
+		stats.queued--;
+		stats.sent++;
+
+		/* Spread a backlog out instead of flooding the parent,
+		 * urgent requests don't wait
+		 */
+		next = head();
+		more = next != NULL;
+		pause = more && next->prio == TX_QUEUE_PRIO_HIGH ? K_NO_WAIT :
+			K_MSEC(CONFIG_COAP_CLIENT_TX_QUEUE_DRAIN_MS);
+	}
+
+	k_spin_unlock(&lock, key);
+
+	if (!entry) {
+		return;
+	}
+
+	PIPELINE_TRACE(TRACE_TX_SEND, kind, len);
+	send_entry(kind, payload, len);
+
+	if (more) {
+		k_work_reschedule(&drain_work, pause);
+	}
+}
+
+void tx_queue_init(tx_queue_send_t send)
+{
+	send_entry = send;
+	k_work_init_delayable(&drain_work, drain);
+}
+
+int tx_queue_push(uint8_t kind, enum tx_queue_prio prio, bool coalesce,
+		  const void *payload, size_t len)
+{
+	struct tx_entry *entry;
+	bool urgent;
+	bool idle;
+
+	if (len > CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	entry = find_slot(kind, prio, coalesce);
+	if (!entry) {
+		stats.dropped++;
+		k_spin_unlock(&lock, key);
+		return -ENOMEM;
+	}
+
+	entry->kind = kind;
+	entry->coalesce = coalesce;
+	entry->len = len;
+	if (len) {
+		memcpy(entry->payload, payload, len);
+	}
+
+	idle = connected && !k_work_delayable_is_pending(&drain_work);
+	urgent = connected && prio == TX_QUEUE_PRIO_HIGH;
+	k_spin_unlock(&lock, key);
+
+	PIPELINE_TRACE(TRACE_TX_PUSH, kind, prio);
+
+	/* A draining queue picks the entry up in its own time, unless it
+	 * is urgent
+	 */
+	if (urgent) {
+		k_work_reschedule(&drain_work, K_NO_WAIT);
+	} else if (idle) {
+		k_work_schedule(&drain_work, K_NO_WAIT);
+	}
+
+	return 0;
+}
+
+void tx_queue_set_connected(bool is_connected)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	connected = is_connected;
+	k_spin_unlock(&lock, key);
+
+	if (is_connected) {
+		k_work_schedule(&drain_work, K_NO_WAIT);
+	}
+}
+
+void tx_queue_get_stats(struct tx_queue_stats *out)
+{
+	k_spinlock_key_t key = k_spin_lock(&lock);
+
+	*out = stats;
+	k_spin_unlock(&lock, key);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file
+ * @defgroup tx_queue Bounded, priority-aware transmit queue
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __TX_QUEUE_H__
+#define __TX_QUEUE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+enum tx_queue_prio {
+	TX_QUEUE_PRIO_HIGH,	/* Control traffic and alarms, sent without a pause */
+	TX_QUEUE_PRIO_NORMAL,	/* Periodic reports */
+	TX_QUEUE_PRIO_LOW,	/* First to go when the queue is full */
+	TX_QUEUE_PRIO_COUNT
+};
+
+/** @brief Type indicates function called to send a queued entry.
+ *
+ * Called from the system workqueue, one entry per call.
+ *
+ * @param[in] kind    Resource the entry belongs to, as passed to
+ *                    tx_queue_push().
+ * @param[in] payload Payload of the entry.
+ * @param[in] len     Length of the payload.
+ */
+typedef void (*tx_queue_send_t)(uint8_t kind, const uint8_t *payload,
+				size_t len);
+
+struct tx_queue_stats {
+	uint32_t queued;	/* Entries waiting right now */
+	uint32_t sent;		/* Entries handed to the send function */
+	uint32_t coalesced;	/* Entries that replaced a pending one */
+	uint32_t dropped;	/* Entries lost to a full queue */
+};
+
+/** @brief Set the function sending the entries.
+ */
+void tx_queue_init(tx_queue_send_t send);
+
+/** @brief Queue an entry for sending.
+ *
+ * Entries go out highest priority first, in order within a priority.
+ * A coalescing entry replaces the pending one of the same kind in place,
+ * keeping its position. When the queue is full, the oldest entry of the
+ * lowest priority makes room, unless that priority is above the new one.
+ *
+ * @param[in] kind     Resource the entry belongs to.
+ * @param[in] prio     Priority of the entry.
+ * @param[in] coalesce Only the latest entry of this kind matters.
+ * @param[in] payload  Payload, copied into the queue. May be NULL if
+ *                     len is 0.
+ * @param[in] len      Length of the payload.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL The payload does not fit an entry.
+ * @retval -ENOMEM The queue is full of entries of a higher priority.
+ */
+int tx_queue_push(uint8_t kind, enum tx_queue_prio prio, bool coalesce,
+		  const void *payload, size_t len);
+
+/** @brief Start draining the queue or hold the entries back.
+ *
+ * @param[in] connected Whether entries can be sent.
+ */
+void tx_queue_set_connected(bool connected);
+
+/** @brief Get the queue counters.
+ */
+void tx_queue_get_stats(struct tx_queue_stats *stats);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,73 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Decode the dictionary encoded log of a production build.
+
+Usage:
+    python3 log_decode.py build /dev/ttyACM0
+    python3 log_decode.py build capture.log
+
+Works for all three samples built with overlay-production.conf. A serial
+port is captured until Ctrl+C, then the capture is handed to Zephyr's
+dictionary log parser together with the log database of the build. The
+database must come from the build that is running on the device.
+"""
+
+import argparse
+import os
+import stat
+import subprocess
+import sys
+import tempfile
+
+DATABASE = os.path.join("zephyr", "log_dictionary.json")
+PARSER = os.path.join("scripts", "logging", "dictionary", "log_parser.py")
+
+
+def capture(port, baudrate, out):
+    import serial
+    with serial.Serial(port, baudrate=baudrate, timeout=1) as stream:
+        sys.stderr.write("Capturing %s, stop with Ctrl+C\n" % port)
+        try:
+            while True:
+                out.write(stream.read(256))
+                out.flush()
+        except KeyboardInterrupt:
+            pass
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("build", help="build directory of the image")
+    parser.add_argument("path", help="serial port or capture file")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    parser.add_argument("--zephyr-base", default=os.environ.get("ZEPHYR_BASE"),
+                        help="Zephyr tree, defaults to $ZEPHYR_BASE")
+    args = parser.parse_args()
+
+    database = os.path.join(args.build, DATABASE)
+    if not os.path.isfile(database):
+        sys.exit("%s not found, build with overlay-production.conf" % database)
+    if not args.zephyr_base:
+        sys.exit("Set ZEPHYR_BASE or pass --zephyr-base")
+    log_parser = os.path.join(args.zephyr_base, PARSER)
+
+    logfile = args.path
+    if stat.S_ISCHR(os.stat(args.path).st_mode):
+        with tempfile.NamedTemporaryFile(suffix=".log", delete=False) as out:
+            capture(args.path, args.baudrate, out)
+            logfile = out.name
+
+    try:
+        return subprocess.call([sys.executable, log_parser, "--hex",
+                                database, logfile])
+    finally:
+        if logfile != args.path:
+            os.unlink(logfile)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
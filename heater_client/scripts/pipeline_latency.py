@@ -0,0 +1,166 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Per-stage latency distributions from a CTF trace of the pipeline stages.
+
+Usage:
+    python3 pipeline_latency.py trace
+    python3 pipeline_latency.py trace --csv setpoint_actuation > runs.csv
+
+The trace directory holds the channel0_0 stream of a sensor or heater
+build with overlay-tracing.conf. Zephyr's CTF metadata is taken from
+$ZEPHYR_BASE when the directory has none.
+
+Every stage event is paired with the latest event of the stage before it,
+and a run is traced back from its last stage to its first. Each run counts
+once, with the first last-stage event that reaches back to its start, so
+radio frames that no report caused are left out. With several zones, the
+read of the last zone stands for the control period. Needs the babeltrace2
+Python bindings.
+"""
+
+import argparse
+import os
+import shutil
+import sys
+import tempfile
+
+# Stage names as in common/src/pipeline_trace.h, in the order they are passed
+PIPELINES = {
+    "sample_report": ["rtc_tick", "job_run", "i2c_start", "i2c_done",
+                      "tx_push", "tx_send", "coap_send", "coap_sent",
+                      "radio_tx", "radio_done"],
+    "target_poll": ["rtc_tick", "job_run", "tx_push", "tx_send",
+                    "coap_send", "coap_sent", "radio_tx", "radio_done",
+                    "coap_reply"],
+    "setpoint_actuation": ["setpoint", "ctrl_wake", "temp_start",
+                           "temp_done", "actuate"],
+}
+
+METADATA = os.path.join("subsys", "tracing", "ctf", "tsdl", "metadata")
+
+
+def trace_dir(path, zephyr_base):
+    """A directory with the stream and the metadata, and whether it is ours."""
+    if os.path.isfile(os.path.join(path, "metadata")):
+        return path, False
+    if not zephyr_base:
+        sys.exit("No metadata in %s, set ZEPHYR_BASE or pass --zephyr-base"
+                 % path)
+
+    tmp = tempfile.mkdtemp()
+    for name in os.listdir(path):
+        os.symlink(os.path.abspath(os.path.join(path, name)),
+                   os.path.join(tmp, name))
+    shutil.copy(os.path.join(zephyr_base, METADATA), tmp)
+    return tmp, True
+
+
+def read_events(path):
+    """Named events as (ns, stage, arg0, arg1), in trace order."""
+    import bt2
+
+    events = []
+    for msg in bt2.TraceCollectionMessageIterator(path):
+        if type(msg) is not bt2._EventMessageConst:
+            continue
+        event = msg.event
+        if event.name != "named_event":
+            continue
+        fields = event.payload_field
+        events.append((msg.default_clock_snapshot.ns_from_origin,
+                       str(fields["name"]).rstrip("\0"),
+                       int(fields["arg0"]), int(fields["arg1"])))
+    return events
+
+
+def pair(events, before, stage):
+    """Map each event of a stage to the latest one of the stage before."""
+    pairs = {}
+    latest = None
+    for i, (_, name, _, _) in enumerate(events):
+        if name == before:
+            latest = i
+        elif name == stage and latest is not None:
+            pairs[i] = latest
+    return pairs
+
+
+def runs(events, stages):
+    """Timestamps of every stage, for each run that passed them all."""
+    links = [pair(events, a, b) for a, b in zip(stages, stages[1:])]
+    starts = set()
+    result = []
+    for i, (_, name, _, _) in enumerate(events):
+        if name != stages[-1]:
+            continue
+        chain = [i]
+        for link in reversed(links):
+            if chain[-1] not in link:
+                break
+            chain.append(link[chain[-1]])
+        if len(chain) == len(stages) and chain[-1] not in starts:
+            starts.add(chain[-1])
+            result.append([events[j][0] for j in reversed(chain)])
+    return result
+
+
+def percentile(values, share):
+    return values[min(len(values) - 1, int(share * len(values)))]
+
+
+def report(name, stages, timestamps):
+    print("%s, %d runs [us]" % (name, len(timestamps)))
+    print("  %-24s %9s %9s %9s %9s %9s" %
+          ("stage", "min", "p50", "p90", "p99", "max"))
+    steps = [(stages[k - 1] + " > " + stages[k], k - 1, k)
+             for k in range(1, len(stages))]
+    steps.append(("total", 0, len(stages) - 1))
+    for label, first, last in steps:
+        values = sorted((run[last] - run[first]) / 1000 for run in timestamps)
+        print("  %-24s %9.1f %9.1f %9.1f %9.1f %9.1f" %
+              (label, values[0], percentile(values, 0.5),
+               percentile(values, 0.9), percentile(values, 0.99),
+               values[-1]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("trace", help="CTF trace directory")
+    parser.add_argument("--zephyr-base", default=os.environ.get("ZEPHYR_BASE"),
+                        help="Zephyr tree, defaults to $ZEPHYR_BASE")
+    parser.add_argument("--csv", choices=sorted(PIPELINES),
+                        help="print the stage latencies of every run instead")
+    args = parser.parse_args()
+
+    path, temporary = trace_dir(args.trace, args.zephyr_base)
+    try:
+        events = read_events(path)
+    finally:
+        if temporary:
+            shutil.rmtree(path)
+
+    if args.csv:
+        stages = PIPELINES[args.csv]
+        print(",".join(["start_us"] + stages[1:]))
+        for run in runs(events, stages):
+            print(",".join(["%.1f" % (run[0] / 1000)] +
+                           ["%.1f" % ((b - a) / 1000)
+                            for a, b in zip(run, run[1:])]))
+        return
+
+    found = False
+    for name, stages in PIPELINES.items():
+        timestamps = runs(events, stages)
+        if timestamps:
+            report(name, stages, timestamps)
+            found = True
+    if not found:
+        sys.exit("No complete pipeline run in the trace")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,57 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Compare the flash and RAM footprint of two builds of a sample.
+
+Usage:
+    python3 size_compare.py build_debug build_production
+
+Flash counts every loaded section with contents, the initial values of
+data included. RAM counts the writable sections, zero-initialized and
+no-init ones included. Needs pyelftools, which Zephyr already requires.
+"""
+
+import argparse
+import os
+
+from elftools.elf.constants import SH_FLAGS
+from elftools.elf.elffile import ELFFile
+
+ELF = os.path.join("zephyr", "zephyr.elf")
+
+
+def footprint(build):
+    flash = ram = 0
+    with open(os.path.join(build, ELF), "rb") as f:
+        for section in ELFFile(f).iter_sections():
+            flags = section["sh_flags"]
+            if not flags & SH_FLAGS.SHF_ALLOC:
+                continue
+            if section["sh_type"] != "SHT_NOBITS":
+                flash += section["sh_size"]
+            if flags & SH_FLAGS.SHF_WRITE:
+                ram += section["sh_size"]
+    return flash, ram
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("reference", help="build directory, e.g. the debug build")
+    parser.add_argument("build", help="build directory to compare")
+    args = parser.parse_args()
+
+    before = footprint(args.reference)
+    after = footprint(args.build)
+
+    print("%-6s %10s %10s %10s %8s" %
+          ("", "reference", "build", "saved", "share"))
+    for name, old, new in zip(("flash", "ram"), before, after):
+        print("%-6s %10d %10d %10d %7.1f%%" %
+              (name, old, new, old - new, 100 * (old - new) / old))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,86 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Decode the binary heater telemetry stream into CSV.
+
+Usage:
+    python3 telemetry_decode.py /dev/ttyACM1 > trace.csv
+    python3 telemetry_decode.py capture.bin > trace.csv
+
+Reads from a serial port when pyserial is installed and the path is a
+character device, otherwise from a file.
+"""
+
+import argparse
+import os
+import stat
+import struct
+import sys
+
+SYNC = 0xA5
+FRAME_SIZE = 15
+# seq, timestamp_ms, zone, flags, measured, target, duty
+BODY = struct.Struct("<BIBBhhH")
+FLAG_AUTOTUNE = 0x01
+
+
+def crc8_ccitt(data, crc=0):
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def open_stream(path, baudrate):
+    if stat.S_ISCHR(os.stat(path).st_mode):
+        import serial
+        return serial.Serial(path, baudrate=baudrate, timeout=None)
+    return open(path, "rb")
+
+
+def frames(stream):
+    """Yield decoded frames, resynchronizing on the sync byte after errors."""
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256) if hasattr(stream, "in_waiting") else stream.read(4096)
+        if not chunk:
+            return
+        buf += chunk
+        while len(buf) >= FRAME_SIZE:
+            if buf[0] != SYNC:
+                del buf[0]
+                continue
+            body = bytes(buf[1:FRAME_SIZE - 1])
+            if crc8_ccitt(body) != buf[FRAME_SIZE - 1]:
+                del buf[0]
+                continue
+            del buf[:FRAME_SIZE]
+            yield BODY.unpack(body)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("path", help="serial port or capture file")
+    parser.add_argument("--baudrate", type=int, default=115200)
+    args = parser.parse_args()
+
+    out = sys.stdout
+    out.write("timestamp_ms,zone,measured,target,duty,autotune,lost\n")
+
+    last_seq = None
+    with open_stream(args.path, args.baudrate) as stream:
+        for seq, timestamp, zone, flags, measured, target, duty in frames(stream):
+            lost = 0 if last_seq is None else (seq - last_seq - 1) & 0xFF
+            last_seq = seq
+            out.write("%d,%d,%.2f,%.2f,%.2f,%d,%d\n" % (
+                timestamp, zone, measured / 100, target / 100, duty / 100,
+                bool(flags & FLAG_AUTOTUNE), lost))
+            out.flush()
+
+
+if __name__ == "__main__":
+    main()
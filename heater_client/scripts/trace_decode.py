@@ -0,0 +1,87 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Decode a heater trace downloaded from the HeaterTrace resource into CSV.
+
+Usage:
+    coap-client -m get "coap://[<heater address>]/HeaterTrace" -o trace.bin
+    python3 trace_decode.py trace.bin > trace.csv
+"""
+
+import argparse
+import struct
+import sys
+
+HEADER = struct.Struct("<2sBBBBI")
+STATES = ("running", "triggered", "frozen")
+TRIGGERS = ("none", "manual", "overshoot", "comms_timeout")
+
+
+def varints(data):
+    value = shift = 0
+    for byte in data:
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            yield value
+            value = shift = 0
+
+
+def unzigzag(value):
+    return (value >> 1) ^ -(value & 1)
+
+
+def decode(blob):
+    magic, version, zones, state, trigger, trigger_time = HEADER.unpack_from(blob)
+    if magic != b"HT" or version != 1:
+        raise ValueError("not a version 1 heater trace")
+
+    info = {
+        "zones": zones,
+        "state": STATES[state] if state < len(STATES) else state,
+        "trigger": TRIGGERS[trigger] if trigger < len(TRIGGERS) else trigger,
+        "trigger_ms": trigger_time,
+    }
+
+    samples = []
+    pos = HEADER.size
+    while pos < len(blob):
+        (length,) = struct.unpack_from("<H", blob, pos)
+        pos += 2
+        values = list(varints(blob[pos:pos + length]))
+        pos += length
+
+        # Every chunk restarts the deltas from zero
+        timestamp = 0
+        last = [[0, 0, 0] for _ in range(zones)]
+        step = 1 + 3 * zones
+        for i in range(0, len(values) - step + 1, step):
+            timestamp += values[i]
+            for z in range(zones):
+                for v in range(3):
+                    last[z][v] += unzigzag(values[i + 1 + 3 * z + v])
+                samples.append((timestamp, z, *[x / 100 for x in last[z]]))
+
+    return info, samples
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("path", help="downloaded trace")
+    args = parser.parse_args()
+
+    with open(args.path, "rb") as f:
+        info, samples = decode(f.read())
+
+    sys.stderr.write("%(zones)d zone(s), %(state)s, trigger %(trigger)s "
+                     "at %(trigger_ms)d ms\n" % info)
+    sys.stdout.write("timestamp_ms,zone,measured,target,duty\n")
+    for sample in samples:
+        sys.stdout.write("%d,%d,%.2f,%.2f,%.2f\n" % sample)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <string.h>
+
+#include "ambient.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define SOURCE_ADDR_LEN 16
+#define SOURCE_TIMEOUT_MS (CONFIG_HEATER_AMBIENT_TIMEOUT_S * MSEC_PER_SEC)
+
+struct ambient_source {
+	uint8_t addr[SOURCE_ADDR_LEN];
+	float temperature;
+	float humidity;
+	int64_t updated;	/* 0 for an unused slot */
+};
+
+static struct ambient_source sources[CONFIG_HEATER_AMBIENT_SOURCES];
+static struct k_spinlock ambient_lock;
+
+static bool is_fresh(const struct ambient_source *source, int64_t now)
+{
+	return source->updated && now - source->updated < SOURCE_TIMEOUT_MS;
+}
+
+void ambient_update(const uint8_t *addr, float temperature, float humidity)
+{
+	int64_t now = k_uptime_get();
+	struct ambient_source *slot = NULL;
+	k_spinlock_key_t key = k_spin_lock(&ambient_lock);
+
+	/* Same sensor again, else a free or stale slot */
+	for (int i = 0; i < ARRAY_SIZE(sources); i++) {
+		if (sources[i].updated &&
+		    !memcmp(sources[i].addr, addr, SOURCE_ADDR_LEN)) {
+			slot = &sources[i];
+			break;
+		}
+
+		if (!slot && !is_fresh(&sources[i], now)) {
+			slot = &sources[i];
+		}
+	}
+
+	if (slot) {
+		memcpy(slot->addr, addr, SOURCE_ADDR_LEN);
+		slot->temperature = temperature;
+		slot->humidity = humidity;
+		slot->updated = now;
+	}
+
+	k_spin_unlock(&ambient_lock, key);
+
+	if (!slot) {
+		LOG_WRN("Too many bound sensors, reading dropped");
+	}
+}
+
+bool ambient_get(float *temperature)
+{
+	int64_t now = k_uptime_get();
+	uint32_t count = 0;
+	float sum = 0;
+	k_spinlock_key_t key = k_spin_lock(&ambient_lock);
+
+	for (int i = 0; i < ARRAY_SIZE(sources); i++) {
+		if (is_fresh(&sources[i], now)) {
+			sum += sources[i].temperature;
+			count++;
+		}
+	}
+
+	k_spin_unlock(&ambient_lock, key);
+
+	if (count) {
+		*temperature = sum / count;
+	}
+
+	return count > 0;
+}
+
+uint32_t ambient_source_count(void)
+{
+	int64_t now = k_uptime_get();
+	uint32_t count = 0;
+	k_spinlock_key_t key = k_spin_lock(&ambient_lock);
+
+	for (int i = 0; i < ARRAY_SIZE(sources); i++) {
+		count += is_fresh(&sources[i], now);
+	}
+
+	k_spin_unlock(&ambient_lock, key);
+
+	return count;
+}
@@ -0,0 +1,43 @@
+/**
+ * @file
+ * @defgroup ambient Ambient readings from bound sensor nodes
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __AMBIENT_H__
+#define __AMBIENT_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Store a reading from a bound sensor node.
+ *
+ * @param[in] addr        Address of the sensor node, 16 bytes.
+ * @param[in] temperature Room temperature in degC.
+ * @param[in] humidity    Relative humidity in %.
+ */
+void ambient_update(const uint8_t *addr, float temperature, float humidity);
+
+/** @brief Get the ambient temperature, averaged over the fresh sensors.
+ *
+ * @param[out] temperature Ambient temperature in degC.
+ *
+ * @return true if at least one sensor reported recently.
+ */
+bool ambient_get(float *temperature);
+
+/** @brief Get the number of sensors that reported recently.
+ */
+uint32_t ambient_source_count(void);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,203 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+
+#include <math.h>
+
+#include "autotune.h"
+#include "heater_gains.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define RELAY_DUTY ((float)CONFIG_HEATER_AUTOTUNE_RELAY_DUTY)
+#define HYSTERESIS (CONFIG_HEATER_AUTOTUNE_HYSTERESIS_MC / 1000.0f)
+#define TIMEOUT_MS (CONFIG_HEATER_AUTOTUNE_TIMEOUT_S * MSEC_PER_SEC)
+
+struct autotune_zone {
+	atomic_t state;
+	float requested_setpoint;
+
+	/* Owned by the control loop while the experiment runs */
+	float setpoint;
+	bool relay_on;
+	int64_t start_ms;
+	int64_t last_switch_on_ms;
+	float peak_high;
+	float peak_low;
+	float amplitude_sum;	/* Sum of peak-to-peak swings in degC */
+	int64_t period_sum;	/* Sum of oscillation periods in ms */
+	int cycles;
+
+	float ku;
+	float tu;
+};
+
+static struct autotune_zone zones[CONFIG_HEATER_ZONE_COUNT];
+
+int autotune_start(uint32_t zone, float setpoint)
+{
+	if (zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return -EINVAL;
+	}
+
+	switch (atomic_get(&zones[zone].state)) {
+	case AUTOTUNE_REQUESTED:
+	case AUTOTUNE_RUNNING:
+		return -EBUSY;
+	default:
+		break;
+	}
+
+	zones[zone].requested_setpoint = setpoint;
+	atomic_set(&zones[zone].state, AUTOTUNE_REQUESTED);
+
+	LOG_INF("Auto-tuning of zone %d requested", zone);
+
+	return 0;
+}
+
+void autotune_abort(uint32_t zone)
+{
+	if (zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return;
+	}
+
+	if (atomic_cas(&zones[zone].state, AUTOTUNE_REQUESTED, AUTOTUNE_IDLE) ||
+	    atomic_cas(&zones[zone].state, AUTOTUNE_RUNNING, AUTOTUNE_IDLE)) {
+		LOG_INF("Auto-tuning of zone %d aborted", zone);
+	}
+}
+
+enum autotune_state autotune_get_state(uint32_t zone, float *ku, float *tu)
+{
+	__ASSERT_NO_MSG(zone < CONFIG_HEATER_ZONE_COUNT);
+
+	*ku = zones[zone].ku;
+	*tu = zones[zone].tu;
+
+	return atomic_get(&zones[zone].state);
+}
+
+bool autotune_is_active(uint32_t zone)
+{
+	atomic_val_t state = atomic_get(&zones[zone].state);
+
+	return state == AUTOTUNE_REQUESTED || state == AUTOTUNE_RUNNING;
+}
+
+static void experiment_begin(struct autotune_zone *at, float temperature,
+			     float target, int64_t now_ms)
+{
+	at->setpoint = isnan(at->requested_setpoint) ? target :
+		       at->requested_setpoint;
+	at->relay_on = temperature < at->setpoint;
+	at->start_ms = now_ms;
+	at->last_switch_on_ms = 0;
+	at->peak_high = temperature;
+	at->peak_low = temperature;
+	at->amplitude_sum = 0;
+	at->period_sum = 0;
+	at->cycles = 0;
+}
+
+static void experiment_fail(uint32_t zone, const char *reason)
+{
+	atomic_cas(&zones[zone].state, AUTOTUNE_RUNNING, AUTOTUNE_FAILED);
+	LOG_ERR("Auto-tuning of zone %d failed: %s", zone, reason);
+}
+
+static void experiment_finish(uint32_t zone)
+{
+	struct autotune_zone *at = &zones[zone];
+	struct pid_gains gains;
+	float amplitude = at->amplitude_sum / at->cycles / 2;
+	float relay_amplitude = RELAY_DUTY / 2;
+	int ret;
+
+	/* Describing function of a relay with hysteresis */
+	if (amplitude > HYSTERESIS) {
+		amplitude = sqrtf(amplitude * amplitude - HYSTERESIS * HYSTERESIS);
+	}
+
+	at->ku = 4 * relay_amplitude / (M_PI * amplitude);
+	at->tu = (float)at->period_sum / at->cycles / MSEC_PER_SEC;
+
+#if IS_ENABLED(CONFIG_HEATER_AUTOTUNE_RULE_NO_OVERSHOOT)
+	gains.k_p = 0.2f * at->ku;
+	gains.k_i = 0.4f * at->ku / at->tu;
+	gains.k_d = 0.066f * at->ku * at->tu;
+#else
+	gains.k_p = 0.6f * at->ku;
+	gains.k_i = 1.2f * at->ku / at->tu;
+	gains.k_d = 0.075f * at->ku * at->tu;
+#endif
+
+	heater_gains_set(zone, &gains);
+	ret = heater_gains_save(zone);
+	if (ret) {
+		LOG_WRN("Cannot store gains of zone %d, (error: %d)", zone, ret);
+	}
+
+	atomic_cas(&at->state, AUTOTUNE_RUNNING, AUTOTUNE_DONE);
+
+	LOG_INF("Zone %d tuned: Ku %f Tu %f s, k_p %f k_i %f k_d %f", zone,
+		at->ku, at->tu, gains.k_p, gains.k_i, gains.k_d);
+}
+
+float autotune_step(uint32_t zone, float temperature, float target,
+		    int64_t now_ms)
+{
+	struct autotune_zone *at = &zones[zone];
+
+	if (atomic_cas(&at->state, AUTOTUNE_REQUESTED, AUTOTUNE_RUNNING)) {
+		experiment_begin(at, temperature, target, now_ms);
+		LOG_INF("Auto-tuning zone %d around %f", zone, at->setpoint);
+	}
+
+	if (atomic_get(&at->state) != AUTOTUNE_RUNNING) {
+		return 0;
+	}
+
+	if (now_ms - at->start_ms > TIMEOUT_MS) {
+		experiment_fail(zone, "no steady oscillation");
+		return 0;
+	}
+
+	if (temperature > at->setpoint + CONFIG_HEATER_AUTOTUNE_MAX_EXCURSION) {
+		experiment_fail(zone, "temperature out of range");
+		return 0;
+	}
+
+	at->peak_high = MAX(at->peak_high, temperature);
+	at->peak_low = MIN(at->peak_low, temperature);
+
+	if (at->relay_on && temperature > at->setpoint + HYSTERESIS) {
+		at->relay_on = false;
+	} else if (!at->relay_on && temperature < at->setpoint - HYSTERESIS) {
+		at->relay_on = true;
+
+		/* Every switch-on closes one full oscillation period */
+		if (at->last_switch_on_ms) {
+			at->amplitude_sum += at->peak_high - at->peak_low;
+			at->period_sum += now_ms - at->last_switch_on_ms;
+			at->cycles++;
+		}
+
+		at->last_switch_on_ms = now_ms;
+		at->peak_high = temperature;
+		at->peak_low = temperature;
+
+		if (at->cycles >= CONFIG_HEATER_AUTOTUNE_CYCLES) {
+			experiment_finish(zone);
+			return 0;
+		}
+	}
+
+	return at->relay_on ? RELAY_DUTY : 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file
+ * @defgroup autotune Relay-feedback PID auto-tuning API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __AUTOTUNE_H__
+#define __AUTOTUNE_H__
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Tune around the target the zone is controlled to when the run starts */
+#define AUTOTUNE_CURRENT_TARGET NAN
+
+enum autotune_state {
+	AUTOTUNE_IDLE,
+	AUTOTUNE_REQUESTED,
+	AUTOTUNE_RUNNING,
+	AUTOTUNE_DONE,
+	AUTOTUNE_FAILED,
+};
+
+/** @brief Request a relay experiment on a zone.
+ *
+ * The experiment starts with the next control loop iteration. Once
+ * enough oscillations were observed the ultimate gain Ku and period Tu are
+ * measured and the resulting PID gains are stored for the zone.
+ *
+ * @param[in] zone     zone to tune.
+ * @param[in] setpoint temperature to oscillate around, or
+ *                     AUTOTUNE_CURRENT_TARGET.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL Unknown zone.
+ * @retval -EBUSY  The zone is already being tuned.
+ */
+int autotune_start(uint32_t zone, float setpoint);
+
+/** @brief Abort a requested or running experiment, the gains are kept.
+ */
+void autotune_abort(uint32_t zone);
+
+/** @brief Get the state of a zone and the last measured Ku and Tu [s].
+ */
+enum autotune_state autotune_get_state(uint32_t zone, float *ku, float *tu);
+
+/** @brief Check if the relay drives the zone instead of the PID.
+ *
+ * @note Called from the control loop only.
+ */
+bool autotune_is_active(uint32_t zone);
+
+/** @brief Run one relay experiment iteration.
+ *
+ * @note Called from the control loop only.
+ *
+ * @param[in] zone        zone index.
+ * @param[in] temperature measured temperature in degC.
+ * @param[in] target      current target of the zone in degC.
+ * @param[in] now_ms      uptime in ms.
+ *
+ * @return Heater duty in %.
+ */
+float autotune_step(uint32_t zone, float temperature, float target,
+		    int64_t now_ms);
+
+#endif
+
+/**
+ * @}
+ */
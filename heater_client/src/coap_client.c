@@ -11,10 +11,12 @@
 #include <zephyr/device.h>
 #include <zephyr/pm/device.h>
 
-#include <zephyr/drivers/counter.h>
 #include <zephyr/drivers/i2c.h>
 
 #include "coap_client_utils.h"
+#include "coap_server.h"
+#include "node_config.h"
+#include "scheduler.h"
 
 LOG_MODULE_DECLARE(coap_client_utils);
 
@@ -22,11 +24,26 @@ LOG_MODULE_DECLARE(coap_client_utils);
 #define COUNTER_LED DK_LED2
 #define MTD_SED_LED DK_LED3
 
-#define ALARM_DELAY 1000000 /*1 second, units for function is usec*/
-#define ALARM_CHANNEL 0
-
 static bool isLedOn = 0;
 
+static struct scheduler_job poll_job;
+static bool polling_started;
+
+BUILD_ASSERT(CONFIG_HEATER_SETPOINT_POLL_PERIOD_MS > CONFIG_SCHEDULER_COALESCE_MS,
+	     "The poll period must be longer than the coalescing window");
+
+static int start_polling(uint32_t period_ms)
+{
+	int ret = scheduler_job_periodic(&poll_job, period_ms,
+					 coap_client_get_phase(period_ms));
+
+	if (ret) {
+		LOG_ERR("Cannot poll every %u ms, (error: %d)", period_ms, ret);
+	}
+
+	return ret;
+}
+
 static void on_ot_connect(struct k_work *item)
 {
 	ARG_UNUSED(item);
@@ -59,19 +76,70 @@ static void on_mtd_mode_toggle(uint32_t med)
 	dk_set_led(MTD_SED_LED, med);
 }
 
-static counter_top_callback_t submit_new_temperature_work (const struct device *dev, void *user_data){
-	ARG_UNUSED(user_data);
-	//printk("countering every second!\n");
+static void poll_new_temperature(struct scheduler_job *job)
+{
+	ARG_UNUSED(job);
 	dk_set_led(COUNTER_LED, !isLedOn); 
 	isLedOn = !isLedOn;
 
-	if (isProvisioned()){
+	if (IS_ENABLED(CONFIG_HEATER_SETPOINT_POLL) && isProvisioned()){
 		coap_client_get_new_target_temp();
 	}
 }
 
-float retrieve_stored_target_temp(void){
-	return coap_utils_retrieve_stored_target_temp();
+/* Apply parameters changed over CoAP, from the shell or loaded at boot */
+static int on_config_changed(enum node_config_id id, int32_t value)
+{
+	switch (id) {
+	case NODE_CONFIG_PERIOD:
+		return polling_started ? start_polling(value) : 0;
+
+	case NODE_CONFIG_POLL:
+		return coap_client_set_poll_period(value);
+
+	case NODE_CONFIG_MODE:
+		return coap_client_set_link_mode(value);
+
+	case NODE_CONFIG_CSL:
+		return coap_client_set_csl_period(value);
+
+	default:
+		return 0;
+	}
+}
+
+void retrieve_stored_target_temps(float *targets){
+	coap_utils_retrieve_stored_target_temps(targets);
+}
+
+#if defined(CONFIG_HEATER_ALARMS)
+/* Drop this far below the threshold before the alarm can fire again [C] */
+#define OVERTEMP_HYSTERESIS 2.0f
+
+static void check_overtemp(uint32_t zone, float measured)
+{
+	static bool raised[CONFIG_HEATER_ZONE_COUNT];
+	float limit = node_config_get(NODE_CONFIG_OVERTEMP);
+	char text[24];
+
+	if (!raised[zone] && measured >= limit) {
+		raised[zone] = true;
+		snprintk(text, sizeof(text), "overtemp=%u,%.1f", zone,
+			 (double)measured);
+		coap_client_send_alarm(text);
+	} else if (raised[zone] && measured < limit - OVERTEMP_HYSTERESIS) {
+		raised[zone] = false;
+	}
+}
+#endif
+
+void report_zone_state(uint32_t zone, float measured, float duty)
+{
+	coap_utils_store_zone_state(zone, measured, duty);
+
+#if defined(CONFIG_HEATER_ALARMS)
+	check_overtemp(zone, measured);
+#endif
 }
 
 void coap_client_init(void)
@@ -91,30 +159,30 @@ void coap_client_init(void)
 		return;
 	}
 
-	const struct device* rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc2));
-	counter_stop(rtc_dev);
-	struct counter_top_cfg counter_cfg;
-	counter_cfg.ticks = counter_us_to_ticks(rtc_dev, 5*ALARM_DELAY);
-	counter_cfg.callback = submit_new_temperature_work;
-	counter_cfg.user_data = &counter_cfg;
-	ret = counter_set_top_value(rtc_dev, &counter_cfg);
-
-
-	if (-EINVAL == ret) {
-		printk("Alarm settings invalid\n");
-	} else if (-ENOTSUP == ret) {
-		printk("Alarm setting request not supported\n");
-	} else if (ret != 0) {
-		printk("Error\n");
+	ret = scheduler_init();
+	if (ret) {
+		LOG_ERR("Cannot init scheduler, (error: %d)", ret);
+		return;
 	}
+	scheduler_job_init(&poll_job, poll_new_temperature);
 
 	coap_client_utils_init(on_ot_connect, on_ot_disconnect,
 			       on_mtd_mode_toggle);
+	node_config_set_callback(on_config_changed);
+
+	if (IS_ENABLED(CONFIG_HEATER_COAP_SERVER)) {
+		ret = coap_server_init();
+		if (ret) {
+			LOG_ERR("Cannot start CoAP server, (error: %d)", ret);
+		}
+	}
 
 	while (!isProvisioned()){
 		coap_client_send_provisioning_request();
 		printk("waiting for provisioning");
 		k_sleep(K_SECONDS(10));
 	}
-	counter_start(rtc_dev);
+
+	start_polling(node_config_get(NODE_CONFIG_PERIOD));
+	polling_started = true;
 }
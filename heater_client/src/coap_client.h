@@ -4,6 +4,8 @@
 
 void coap_client_init(void);
 
-float retrieve_stored_target_temp(void);
+void retrieve_stored_target_temps(float *targets);
+
+void report_zone_state(uint32_t zone, float measured, float duty);
 
 #endif
\ No newline at end of file
@@ -10,14 +10,27 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/net/openthread.h>
 #include <zephyr/net/socket.h>
+#include <openthread/coap.h>
+#include <openthread/link.h>
 #include <openthread/thread.h>
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <zephyr/debug/thread_analyzer.h>
 
 #include "coap_server_client_interface.h"
 #include "coap_client_utils.h"
+#include "alarm.h"
+#include "csl.h"
+#include "autotune.h"
+#include "hot_path_log.h"
+#include "oscore_client.h"
+#include "pipeline_trace.h"
+#include "profile.h"
+#include "setpoint.h"
+#include "trace_recorder.h"
+#include "tx_queue.h"
 
 LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
@@ -25,8 +38,6 @@ LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
 static uint32_t poll_period;
 
-static bool is_connected;
-
 // static struct k_work send_sensor_data_work;
 static struct k_work toggle_MTD_SED_work;
 static struct k_work on_connect_work;
@@ -36,17 +47,40 @@ static struct k_work on_disconnect_work;
 //Ease passing of data to the function
 //Contains k_work object inside as well
 
-static struct work_var_container provisioning_container;
-static struct work_heater_container target_temp_data_container = {
-	.target_temperature = 40.0
+/* Requests waiting in the transmit queue, each kind supersedes its
+ * previous request, the reply reflects the latest state anyway.
+ */
+enum tx_kind {
+	TX_KIND_PROVISIONING,
+	TX_KIND_PROFILE,
+	TX_KIND_TARGET,
+	TX_KIND_ALARM,
 };
 
+/* Latest zone state, sent along with every HeaterNode request */
+struct zone_state {
+	float measured;
+	float duty;
+};
+
+static struct zone_state zone_states[CONFIG_HEATER_ZONE_COUNT];
+static struct k_spinlock zone_state_lock;
+
 mtd_mode_toggle_cb_t on_mtd_mode_toggle;
 
+/* Uptime of the last HeaterNode reply, used to detect a silent server */
+static int64_t last_target_reply_ms;
+
 /* Options supported by the server */
 static const char *const node_option[] = { NODE1_URI_PATH, NULL };
 static const char *const provisioning_option[] = { PROVISIONING_URI_PATH, NULL };
 static const char *const heater_option[] = { HEATER_URI_PATH, NULL };
+#if defined(CONFIG_HEATER_PROFILE)
+static const char *const profile_option[] = { HEATER_PROFILE_URI_PATH, NULL };
+#endif
+#if defined(CONFIG_HEATER_ALARMS)
+static const char *const alarm_option[] = { ALARM_URI_PATH, NULL };
+#endif
 
 /* Thread multicast mesh local address */
 static struct sockaddr_in6 multicast_local_addr = {
@@ -67,6 +101,31 @@ static struct sockaddr_in6 unique_local_addr = {
 	.sin6_scope_id = 0U
 };
 
+/* The provisioning reply and the failover switch servers while requests
+ * are sent from other threads, senders work on a copy
+ */
+static struct k_spinlock server_lock;
+
+/* Called with server_lock held */
+static void server_addr_set(const struct in6_addr *addr)
+{
+	unique_local_addr.sin6_addr = *addr;
+	inet_ntop(AF_INET6, addr, unique_local_addr_str,
+		  sizeof(unique_local_addr_str));
+}
+
+/* Copy the server address, and its text form unless str is NULL */
+static void server_addr_get(struct sockaddr_in6 *addr, char *str)
+{
+	k_spinlock_key_t key = k_spin_lock(&server_lock);
+
+	*addr = unique_local_addr;
+	if (str) {
+		memcpy(str, unique_local_addr_str, INET6_ADDRSTRLEN);
+	}
+	k_spin_unlock(&server_lock, key);
+}
+
 static bool is_mtd_in_med_mode(otInstance *instance)
 {
 	return otThreadGetLinkMode(instance).mRxOnWhenIdle;
@@ -88,7 +147,7 @@ static void poll_period_response_set(void)
 		error = otLinkSetPollPeriod(instance, RESPONSE_POLL_PERIOD);
 		__ASSERT(error == OT_ERROR_NONE, "Failed to set pool period");
 
-		LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
+		HOT_LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
 	}
 }
 
@@ -105,11 +164,159 @@ static void poll_period_restore(void)
 		error = otLinkSetPollPeriod(instance, poll_period);
 		__ASSERT_NO_MSG(error == OT_ERROR_NONE);
 
-		LOG_INF("Poll Period: %dms restored", poll_period);
+		HOT_LOG_INF("Poll Period: %dms restored", poll_period);
 		poll_period = 0;
 	}
 }
 
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+/* Slot out of equal slots of the period, valid when slot_count is set */
+static uint32_t phase_slot;
+static uint32_t phase_slot_count;
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+/* The provisioned server followed by the ";alt=<addr>" ones */
+static struct in6_addr servers[1 + CONFIG_COAP_CLIENT_ALT_SERVERS];
+static uint8_t server_count;
+static uint8_t server_index;
+static atomic_t server_failures;	/* Unanswered exchanges in a row */
+static struct k_work failover_work;
+static struct k_work_delayable reprovision_work;
+
+/* Called with the outcome of every exchange the server has to answer */
+static void server_exchange_result(bool answered)
+{
+	if (answered) {
+		atomic_clear(&server_failures);
+		k_work_cancel_delayable(&reprovision_work);
+		return;
+	}
+
+	if (atomic_inc(&server_failures) + 1 ==
+	    CONFIG_COAP_CLIENT_FAILOVER_THRESHOLD) {
+		k_work_submit(&failover_work);
+	}
+}
+
+static void server_failover(struct k_work *item)
+{
+	char str[INET6_ADDRSTRLEN];
+	k_spinlock_key_t key;
+	bool switched;
+
+	ARG_UNUSED(item);
+
+	atomic_clear(&server_failures);
+
+	key = k_spin_lock(&server_lock);
+	switched = server_count > 1;
+	if (switched) {
+		server_index = (server_index + 1) % server_count;
+		server_addr_set(&servers[server_index]);
+	}
+	memcpy(str, unique_local_addr_str, sizeof(str));
+	k_spin_unlock(&server_lock, key);
+
+	if (switched) {
+		LOG_WRN("Server not answering, switching to %s", str);
+	} else {
+		LOG_WRN("Server %s not answering", str);
+	}
+
+	/* Look for a server that came back with a new address */
+	k_work_reschedule(&reprovision_work, K_NO_WAIT);
+}
+
+static void server_reprovision(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	coap_client_send_provisioning_request();
+	k_work_reschedule(&reprovision_work,
+			  K_SECONDS(CONFIG_COAP_CLIENT_REPROVISION_INTERVAL_S));
+}
+
+/* A provisioning reply names a new primary, alternates follow */
+static void server_list_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&server_lock);
+
+	servers[0] = unique_local_addr.sin6_addr;
+	server_count = 1;
+	server_index = 0;
+	k_spin_unlock(&server_lock, key);
+
+	atomic_clear(&server_failures);
+	k_work_cancel_delayable(&reprovision_work);
+}
+
+static void server_list_add(const char *addr)
+{
+	struct in6_addr server;
+	k_spinlock_key_t key;
+	bool added = false;
+
+	if (inet_pton(AF_INET6, addr, &server)) {
+		key = k_spin_lock(&server_lock);
+		if (server_count < ARRAY_SIZE(servers)) {
+			servers[server_count++] = server;
+			added = true;
+		}
+		k_spin_unlock(&server_lock, key);
+	}
+
+	if (!added) {
+		LOG_WRN("Ignoring alternate server: %s", addr);
+	}
+}
+#endif /* CONFIG_COAP_CLIENT_FAILOVER */
+
+/* Provisioning replies carry the server address, optionally followed by
+ * ";key=value" extensions, e.g.
+ * "fd00::1;slot=3/50;alt=fd00::2".
+ */
+static void handle_provisioning_option(const char *key, const char *value)
+{
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	if (!strcmp(key, "oscore")) {
+		oscore_client_provision(value);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	if (!strcmp(key, "alt")) {
+		server_list_add(value);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+	if (!strcmp(key, "slot")) {
+		uint32_t slot, count = 0;
+		char *end;
+
+		slot = strtoul(value, &end, 10);
+		if (*end == '/') {
+			count = strtoul(end + 1, NULL, 10);
+		}
+
+		if (slot >= count) {
+			LOG_WRN("Invalid slot: %s", value);
+			return;
+		}
+
+		phase_slot = slot;
+		phase_slot_count = count;
+		LOG_INF("Assigned slot %u of %u", slot, count);
+		return;
+	}
+#endif
+
+	LOG_DBG("Ignoring provisioning option '%s'", key);
+}
+
 static int on_provisioning_reply(const struct coap_packet *response,
 				 struct coap_reply *reply,
 				 const struct sockaddr *from)
@@ -117,6 +324,10 @@ static int on_provisioning_reply(const struct coap_packet *response,
 	int ret = 0;
 	const uint8_t *payload;
 	uint16_t payload_size = 0u;
+	char text[INET6_ADDRSTRLEN + 64] = {0};
+	char *addr, *option, *save;
+	struct in6_addr server;
+	k_spinlock_key_t key;
 	
 	//Testing for printing out IPaddr from OT
 	// otInstance *instance = openthread_get_default_instance();
@@ -158,14 +369,34 @@ static int on_provisioning_reply(const struct coap_packet *response,
 
 	// LOG_HEXDUMP_INF(ipaddr_int, 16, "Fully converted IP fragment");
 	//LOG_INF("%s",payload);
-	if (!inet_pton(AF_INET6, payload, &unique_local_addr.sin6_addr)){
-		LOG_ERR("Received data is not IPv6 address: %d", errno);
-		ret = -errno;
+	memcpy(text, payload, MIN(payload_size, sizeof(text) - 1));
+	addr = strtok_r(text, ";", &save);
+
+	if (!addr || !inet_pton(AF_INET6, addr, &server)){
+		LOG_ERR("Received data is not IPv6 address");
+		ret = -EINVAL;
 		goto exit;
 	}
-	memcpy(unique_local_addr_str, payload, payload_size);
 
-	LOG_INF("Received peer address: %s", unique_local_addr_str);
+	key = k_spin_lock(&server_lock);
+	server_addr_set(&server);
+	k_spin_unlock(&server_lock, key);
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_list_reset();
+#endif
+
+	while ((option = strtok_r(NULL, ";", &save)) != NULL) {
+		char *value = strchr(option, '=');
+
+		if (value) {
+			*value++ = '\0';
+			handle_provisioning_option(option, value);
+		}
+	}
+
+	LOG_INF("Received peer address: %s", addr);
+	last_target_reply_ms = k_uptime_get();
 
 exit:
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
@@ -175,7 +406,7 @@ exit:
 	return ret;
 }
 
-static void send_provisioning_request(struct k_work *item)
+static void send_provisioning_request(void)
 {
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
 		/* decrease the polling period for higher responsiveness */
@@ -188,12 +419,267 @@ static void send_provisioning_request(struct k_work *item)
 			  provisioning_option, NULL, 0u, on_provisioning_reply);
 }
 
+#if defined(CONFIG_HEATER_ALARMS)
+static void on_alarm_done(bool acked)
+{
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_exchange_result(acked);
+#endif
+}
+
+/* Alarms are confirmable, they must not get lost like a routine poll */
+static void send_alarm(const char *text, size_t len)
+{
+	struct sockaddr_in6 server;
+
+	server_addr_get(&server, NULL);
+
+	/* Poll fast enough for the ACK to make it through the parent */
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_response_set();
+	}
+
+	if (alarm_send(&server, alarm_option, text, len, on_alarm_done) &&
+	    IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+}
+#endif /* CONFIG_HEATER_ALARMS */
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+/* Set while a HeaterNode poll waits for its reply */
+static atomic_t target_request_pending;
+#endif
+
+/* Any HeaterNode or HeaterProfile reply shows the server is alive */
+static void on_server_reply(void)
+{
+	last_target_reply_ms = k_uptime_get();
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	atomic_clear(&target_request_pending);
+	server_exchange_result(true);
+#endif
+}
+
+/* Apply a HeaterNode representation: a command or the zone targets */
+static int handle_target_payload(const uint8_t *payload, uint16_t payload_size)
+{
+	static bool profile_requested;
+	uint32_t changed;
+	int ret = 0;
+	char new_target_string[8 * CONFIG_HEATER_ZONE_COUNT + 8] = {0};
+
+	PIPELINE_TRACE(TRACE_COAP_REPLY, payload_size, 0);
+	on_server_reply();
+
+	memcpy(new_target_string, payload,
+	       MIN(payload_size, sizeof(new_target_string) - 1));
+
+	/* The server can ask for a relay experiment instead of a new target */
+	if (!strncmp(new_target_string, HEATER_CMD_AUTOTUNE,
+		     strlen(HEATER_CMD_AUTOTUNE))) {
+		LOG_INF("Auto-tuning requested by the server");
+		for (uint32_t zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+			autotune_start(zone, AUTOTUNE_CURRENT_TARGET);
+		}
+		goto exit;
+	}
+
+	if (IS_ENABLED(CONFIG_HEATER_PROFILE) &&
+	    !strncmp(new_target_string, HEATER_CMD_PROFILE,
+		     strlen(HEATER_CMD_PROFILE))) {
+		/* Polling goes on while the profile runs, download it once */
+		if (!profile_requested) {
+			profile_requested = true;
+			tx_queue_push(TX_KIND_PROFILE, TX_QUEUE_PRIO_HIGH, true,
+				      NULL, 0);
+		}
+		goto exit;
+	}
+
+	/* One target per zone, a single target drives every zone */
+	float new_targets[CONFIG_HEATER_ZONE_COUNT];
+	int count = setpoint_parse(new_target_string, new_targets);
+
+	if (count < 0) {
+		LOG_ERR("Invalid target: %s", new_target_string);
+		ret = count;
+		goto exit;
+	}
+
+	/* Zones with a profile ignore the server target until it changes,
+	 * a new target then replaces whatever the profile left behind.
+	 */
+	profile_requested = false;
+	changed = setpoint_publish(new_targets, count);
+	if (IS_ENABLED(CONFIG_HEATER_PROFILE) && changed) {
+		profile_stop_zones(changed);
+	}
+
+	HOT_LOG_INF("retrieved string: %s, new target: %f", new_target_string, new_targets[0]);
+	exit:
+	return ret;
+}
+
+#if defined(CONFIG_HEATER_CONDITIONAL_POLL)
+/* Sent in plain text, an OSCORE build must not have them */
+BUILD_ASSERT(!IS_ENABLED(CONFIG_COAP_CLIENT_OSCORE),
+	     "Conditional polls can't be OSCORE protected");
+
+#define COAP_CODE_FETCH ((otCoapCode)OT_COAP_CODE(0, 5))
+#define COAP_ETAG_MAX_LENGTH 8
+/* RFC 7967 No-Response, the value selects the suppressed classes */
+#define COAP_OPTION_NO_RESPONSE 258
+#define COAP_NO_RESPONSE_SUCCESS BIT(1)
+
+/* Validator and freshness of the last HeaterNode representation */
+static uint8_t target_etag[COAP_ETAG_MAX_LENGTH];
+static uint8_t target_etag_len;
+static int64_t target_fresh_until;
+
+static void on_conditional_target_reply(void *context, otMessage *message,
+					const otMessageInfo *message_info,
+					otError result)
+{
+	char payload[8 * CONFIG_HEATER_ZONE_COUNT + 8];
+	otCoapOptionIterator iterator;
+	const otCoapOption *option;
+	uint64_t max_age;
+	uint16_t len;
+
+	ARG_UNUSED(context);
+	ARG_UNUSED(message_info);
+
+	if (result != OT_ERROR_NONE) {
+		LOG_WRN("No 'new target temp' reply: %d", result);
+		return;
+	}
+
+	if (otCoapOptionIteratorInit(&iterator, message) != OT_ERROR_NONE) {
+		return;
+	}
+
+	/* Don't ask again before the server's value expires */
+	target_fresh_until = 0;
+	option = otCoapOptionIteratorGetFirstOptionMatching(&iterator,
+							    OT_COAP_OPTION_MAX_AGE);
+	if (option &&
+	    otCoapOptionIteratorGetOptionUintValue(&iterator, &max_age) ==
+	    OT_ERROR_NONE) {
+		target_fresh_until = k_uptime_get() + max_age * MSEC_PER_SEC;
+	}
+
+	switch (otCoapMessageGetCode(message)) {
+	case OT_COAP_CODE_VALID:
+		/* Our stored targets are still current */
+		on_server_reply();
+		return;
+
+	case OT_COAP_CODE_CONTENT:
+		break;
+
+	default:
+		LOG_WRN("Unexpected 'new target temp' reply: %d",
+			otCoapMessageGetCode(message));
+		return;
+	}
+
+	target_etag_len = 0;
+	option = otCoapOptionIteratorGetFirstOptionMatching(&iterator,
+							    OT_COAP_OPTION_E_TAG);
+	if (option && option->mLength <= sizeof(target_etag) &&
+	    otCoapOptionIteratorGetOptionValue(&iterator, target_etag) ==
+	    OT_ERROR_NONE) {
+		target_etag_len = option->mLength;
+	}
+
+	len = otMessageRead(message, otMessageGetOffset(message), payload,
+			    sizeof(payload));
+	if (len == 0) {
+		LOG_ERR("No data received");
+		return;
+	}
+
+	handle_target_payload((const uint8_t *)payload, len);
+}
+
+static void send_conditional_target_request(const struct sockaddr_in6 *server,
+					    const char *report, size_t len,
+					    bool report_only)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otMessageInfo message_info = { 0 };
+	otMessage *message;
+	otError error = OT_ERROR_NO_BUFS;
+
+	openthread_api_mutex_lock(context);
+
+	message = otCoapNewMessage(context->instance, NULL);
+	if (message == NULL) {
+		goto exit;
+	}
+
+	otCoapMessageInit(message, OT_COAP_TYPE_NON_CONFIRMABLE, COAP_CODE_FETCH);
+	otCoapMessageGenerateToken(message, OT_COAP_DEFAULT_TOKEN_LENGTH);
+
+	/* Options go in ascending number order: ETag, Uri-Path, Content-Format,
+	 * No-Response
+	 */
+	error = target_etag_len ?
+		otCoapMessageAppendOption(message, OT_COAP_OPTION_E_TAG,
+					  target_etag_len, target_etag) :
+		OT_ERROR_NONE;
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendUriPathOptions(message, HEATER_URI_PATH);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendContentFormatOption(
+			message, OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN);
+	}
+	if (error == OT_ERROR_NONE && report_only) {
+		/* The targets are still fresh, no answer to a stored report */
+		error = otCoapMessageAppendUintOption(message,
+						      COAP_OPTION_NO_RESPONSE,
+						      COAP_NO_RESPONSE_SUCCESS);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageSetPayloadMarker(message);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otMessageAppend(message, report, len);
+	}
+	if (error != OT_ERROR_NONE) {
+		goto exit;
+	}
+
+	memcpy(&message_info.mPeerAddr, &server->sin6_addr,
+	       sizeof(message_info.mPeerAddr));
+	message_info.mPeerPort = COAP_PORT;
+
+	error = otCoapSendRequest(context->instance, message, &message_info,
+				  report_only ? NULL : on_conditional_target_reply,
+				  NULL);
+
+exit:
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send 'new target temp' request: %d", error);
+		if (message) {
+			otMessageFree(message);
+		}
+	}
+
+	openthread_api_mutex_unlock(context);
+}
+#else
 static int on_get_new_target_reply(const struct coap_packet *response,
 				 struct coap_reply *reply,
 				 const struct sockaddr *from){
-	int ret = 0;
 	const uint8_t *payload;
-	char new_target_string[8];
 	uint16_t payload_size = 0u;
 	
 	ARG_UNUSED(reply);
@@ -203,29 +689,141 @@ static int on_get_new_target_reply(const struct coap_packet *response,
 
 	if (payload == NULL) {
 		LOG_ERR("No data received");
-		ret = -EINVAL;
-		goto exit;
+		return -EINVAL;
 	}
-	memcpy(new_target_string, payload, payload_size);
-	target_temp_data_container.target_temperature = strtof(new_target_string,NULL);
-	LOG_INF("retrieved string: %s, new target: %f", new_target_string, target_temp_data_container.target_temperature);
-	exit:
+
+	return handle_target_payload(payload, payload_size);
+}
+#endif /* CONFIG_HEATER_CONDITIONAL_POLL */
+
+#if defined(CONFIG_HEATER_PROFILE)
+static int on_profile_reply(const struct coap_packet *response,
+			    struct coap_reply *reply,
+			    const struct sockaddr *from)
+{
+	static struct profile parsed;
+	const uint8_t *payload;
+	uint16_t payload_size = 0u;
+	int ret;
+
+	ARG_UNUSED(reply);
+	ARG_UNUSED(from);
+
+	payload = coap_packet_get_payload(response, &payload_size);
+
+	if (payload == NULL) {
+		LOG_ERR("No data received");
+		return -EINVAL;
+	}
+	on_server_reply();
+
+	ret = profile_load(payload, payload_size, &parsed);
+	if (ret) {
+		LOG_ERR("Cannot load profile: %d", ret);
+	}
+
 	return ret;
 }
+#endif
+
+/* Request to the provisioned server, OSCORE protected if enabled */
+static void send_server_request(const struct sockaddr_in6 *server,
+				enum coap_method method,
+				const char *const *path, char *payload,
+				uint16_t len, coap_reply_t reply)
+{
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	/* Never fall back to plain text */
+	int ret = oscore_client_send(false, method, server, path,
+				     (const uint8_t *)payload, len, reply);
+
+	if (ret) {
+		LOG_WRN("Cannot send protected '%s' request: %d", path[0], ret);
+	}
+#else
+	coap_send_request(method, (const struct sockaddr *)server, path,
+			  payload, len, reply);
+#endif
+}
+
+#if defined(CONFIG_HEATER_PROFILE)
+static void send_profile_request(void)
+{
+	struct sockaddr_in6 server;
+	char str[INET6_ADDRSTRLEN];
+
+	server_addr_get(&server, str);
+
+	LOG_INF("Send 'profile' request to: %s", str);
+	send_server_request(&server, COAP_METHOD_GET, profile_option, NULL, 0u,
+			    on_profile_reply);
+}
+#endif
 
-static void send_new_target_request(struct k_work *item)
+static void send_new_target_request(void)
 {
-	if (unique_local_addr.sin6_addr.s6_addr16[0] == 0) {
+	struct sockaddr_in6 server;
+	char str[INET6_ADDRSTRLEN];
+	__maybe_unused bool report_only = false;
+
+	server_addr_get(&server, str);
+
+	if (server.sin6_addr.s6_addr16[0] == 0) {
 		LOG_WRN("Peer address not set. Activate 'provisioning' option "
 			"on the server side");
 		return;
 	}
 
-	LOG_INF("Send 'new target temp' request to: %s", unique_local_addr_str);
+#if defined(CONFIG_HEATER_CONDITIONAL_POLL)
+	/* The server said the last targets stay valid until then, the
+	 * report still goes out but no answer is asked for
+	 */
+	if (k_uptime_get() < target_fresh_until) {
+		last_target_reply_ms = k_uptime_get();
+		report_only = true;
+	}
+#endif
+
+	if (IS_ENABLED(CONFIG_HEATER_TRACE_RECORDER) &&
+	    k_uptime_get() - last_target_reply_ms >
+	    CONFIG_HEATER_TRACE_COMMS_TIMEOUT_S * MSEC_PER_SEC) {
+		trace_recorder_trigger(TRACE_TRIGGER_COMMS_TIMEOUT);
+	}
+
+	/* Report "<measured>,<duty>;..." per zone in the same exchange */
+	char report[16 * CONFIG_HEATER_ZONE_COUNT];
+	struct zone_state states[CONFIG_HEATER_ZONE_COUNT];
+	k_spinlock_key_t key = k_spin_lock(&zone_state_lock);
+	int len = 0;
+
+	memcpy(states, zone_states, sizeof(states));
+	k_spin_unlock(&zone_state_lock, key);
+
+	for (int zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		len += snprintk(report + len, sizeof(report) - len, "%s%.2f,%.1f",
+				zone ? ";" : "", (double)states[zone].measured,
+				(double)states[zone].duty);
+	}
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	/* The previous poll is still unanswered when the next one is due */
+	if (!report_only && atomic_set(&target_request_pending, 1)) {
+		server_exchange_result(false);
+	}
+#endif
+
+	HOT_LOG_INF("Send 'new target temp' request to: %s", str);
 	//thread_analyzer_print();
-	coap_send_request(COAP_METHOD_GET,
-			  (const struct sockaddr *)&unique_local_addr,
-			  heater_option, NULL, 0u, on_get_new_target_reply);
+	PIPELINE_TRACE(TRACE_COAP_SEND, len, 0);
+#if defined(CONFIG_HEATER_CONDITIONAL_POLL)
+	send_conditional_target_request(&server, report,
+					MIN(len, sizeof(report) - 1),
+					report_only);
+#else
+	send_server_request(&server, COAP_METHOD_FETCH, heater_option, report,
+			    MIN(len, sizeof(report) - 1), on_get_new_target_reply);
+#endif
+	PIPELINE_TRACE(TRACE_COAP_SENT, len, 0);
 }
 
 static void toggle_minimal_sleepy_end_device(struct k_work *item)
@@ -238,8 +836,12 @@ static void toggle_minimal_sleepy_end_device(struct k_work *item)
 
 	openthread_api_mutex_lock(context);
 	mode = otThreadGetLinkMode(context->instance);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	error = csl_toggle_link_mode(context->instance, &mode);
+#else
 	mode.mRxOnWhenIdle = !mode.mRxOnWhenIdle;
 	error = otThreadSetLinkMode(context->instance, mode);
+#endif
 	openthread_api_mutex_unlock(context);
 
 	if (error != OT_ERROR_NONE) {
@@ -266,25 +868,47 @@ static void on_thread_state_changed(uint32_t flags, void *context)
 		case OT_DEVICE_ROLE_ROUTER:
 		case OT_DEVICE_ROLE_LEADER:
 			k_work_submit(&on_connect_work);
-			is_connected = true;
+			tx_queue_set_connected(true);
 			break;
 
 		case OT_DEVICE_ROLE_DISABLED:
 		case OT_DEVICE_ROLE_DETACHED:
 		default:
 			k_work_submit(&on_disconnect_work);
-			is_connected = false;
+			tx_queue_set_connected(false);
 			break;
 		}
 	}
 }
 
-static void submit_work_if_connected(struct k_work *work)
+static void send_queued(uint8_t kind, const uint8_t *payload, size_t len)
 {
-	if (is_connected) {
-		k_work_submit(work);
-	} else {
-		LOG_INF("Connection is broken");
+	ARG_UNUSED(payload);
+	ARG_UNUSED(len);
+
+	switch (kind) {
+#if defined(CONFIG_HEATER_ALARMS)
+	case TX_KIND_ALARM:
+		send_alarm((const char *)payload, len);
+		break;
+#endif
+
+	case TX_KIND_PROVISIONING:
+		send_provisioning_request();
+		break;
+
+#if defined(CONFIG_HEATER_PROFILE)
+	case TX_KIND_PROFILE:
+		send_profile_request();
+		break;
+#endif
+
+	case TX_KIND_TARGET:
+		send_new_target_request();
+		break;
+
+	default:
+		break;
 	}
 }
 
@@ -292,8 +916,28 @@ bool isProvisioned(){
 	return unique_local_addr_str[0];
 }
 
-float coap_utils_retrieve_stored_target_temp(void){
-	return target_temp_data_container.target_temperature;
+bool coap_utils_is_server_addr(const struct in6_addr *addr)
+{
+	struct sockaddr_in6 server;
+
+	server_addr_get(&server, NULL);
+
+	return isProvisioned() &&
+	       !memcmp(addr, &server.sin6_addr, sizeof(*addr));
+}
+
+void coap_utils_retrieve_stored_target_temps(float *targets)
+{
+	setpoint_read(targets, NULL);
+}
+
+void coap_utils_store_zone_state(uint32_t zone, float measured, float duty)
+{
+	k_spinlock_key_t key = k_spin_lock(&zone_state_lock);
+
+	zone_states[zone].measured = measured;
+	zone_states[zone].duty = duty;
+	k_spin_unlock(&zone_state_lock, key);
 }
 
 void coap_client_utils_init(ot_connection_cb_t on_connect,
@@ -306,8 +950,16 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
 
 	k_work_init(&on_connect_work, on_connect);
 	k_work_init(&on_disconnect_work, on_disconnect);
-	k_work_init(&target_temp_data_container.work_obj, send_new_target_request);
-	k_work_init(&provisioning_container.work_obj, send_provisioning_request);
+	tx_queue_init(send_queued);
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	if (oscore_client_init()) {
+		LOG_ERR("OSCORE unavailable, server exchanges are not sent");
+	}
+#endif
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	k_work_init(&failover_work, server_failover);
+	k_work_init_delayable(&reprovision_work, server_reprovision);
+#endif
 
 	openthread_set_state_changed_cb(on_thread_state_changed);
 	openthread_start(openthread_get_default_context());
@@ -317,16 +969,61 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
 			    toggle_minimal_sleepy_end_device);
 		update_device_state();
 	}
+
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	/* Start as a synchronized sleepy end device */
+	csl_start();
+#endif
 }
 
 void coap_client_get_new_target_temp(uint16_t temperature_data, uint16_t humidity_data)
 {
-	submit_work_if_connected(&target_temp_data_container.work_obj);
+	tx_queue_push(TX_KIND_TARGET, TX_QUEUE_PRIO_NORMAL, true, NULL, 0);
+}
+
+int coap_client_send_alarm(const char *text)
+{
+	if (!IS_ENABLED(CONFIG_HEATER_ALARMS)) {
+		return -ENOTSUP;
+	}
+
+	/* Alarms jump the queue and are never merged */
+	return tx_queue_push(TX_KIND_ALARM, TX_QUEUE_PRIO_HIGH, false, text,
+			     strlen(text));
+}
+
+void coap_client_refresh_target(void)
+{
+#if defined(CONFIG_HEATER_CONDITIONAL_POLL)
+	/* Don't let an unexpired Max-Age hold the catch-up back */
+	target_fresh_until = 0;
+#endif
+	tx_queue_push(TX_KIND_TARGET, TX_QUEUE_PRIO_NORMAL, true, NULL, 0);
 }
 
 void coap_client_send_provisioning_request(void)
 {
-	submit_work_if_connected(&provisioning_container.work_obj);
+	tx_queue_push(TX_KIND_PROVISIONING, TX_QUEUE_PRIO_HIGH, true, NULL, 0);
+}
+
+int coap_client_set_csl_period(uint32_t period_ms)
+{
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	return csl_set_period(period_ms);
+#else
+	ARG_UNUSED(period_ms);
+
+	return -ENOTSUP;
+#endif
+}
+
+uint32_t coap_client_get_csl_period(void)
+{
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	return csl_get_period();
+#else
+	return 0;
+#endif
 }
 
 void coap_client_toggle_minimal_sleepy_end_device(void)
@@ -334,4 +1031,98 @@ void coap_client_toggle_minimal_sleepy_end_device(void)
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
 		k_work_submit(&toggle_MTD_SED_work);
 	}
-}
\ No newline at end of file
+}
+
+int coap_client_set_link_mode(enum coap_client_link_mode mode)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otLinkModeConfig config;
+	otError error;
+
+	if (!IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED) ||
+	    (mode == COAP_CLIENT_LINK_SSED &&
+	     !IS_ENABLED(CONFIG_OPENTHREAD_CSL_RECEIVER))) {
+		return -ENOTSUP;
+	}
+
+	openthread_api_mutex_lock(context);
+	config = otThreadGetLinkMode(context->instance);
+	config.mRxOnWhenIdle = (mode == COAP_CLIENT_LINK_MED);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	/* CSL sampling only makes sense while the receiver sleeps */
+	csl_enable(context->instance, false);
+#endif
+	error = otThreadSetLinkMode(context->instance, config);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	if (error == OT_ERROR_NONE && mode == COAP_CLIENT_LINK_SSED) {
+		error = csl_enable(context->instance, true);
+	}
+#endif
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to set MLE link mode configuration");
+		return -EIO;
+	}
+
+	on_mtd_mode_toggle(config.mRxOnWhenIdle);
+
+	return 0;
+}
+
+int coap_client_set_poll_period(uint32_t period_ms)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otError error;
+
+	openthread_api_mutex_lock(context);
+	error = otLinkSetPollPeriod(context->instance, period_ms);
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to set poll period: %d", error);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+uint32_t coap_client_get_phase(uint32_t period_ms)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otExtAddress eui64;
+	uint64_t hash = 0;
+
+	if (period_ms == 0) {
+		return 0;
+	}
+
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+	if (phase_slot_count) {
+		return (uint64_t)period_ms * phase_slot / phase_slot_count;
+	}
+#endif
+
+	if (!IS_ENABLED(CONFIG_COAP_CLIENT_PHASE_EUI64)) {
+		return 0;
+	}
+
+	openthread_api_mutex_lock(context);
+	otLinkGetFactoryAssignedIeeeEui64(context->instance, &eui64);
+	openthread_api_mutex_unlock(context);
+
+	for (int i = 0; i < sizeof(eui64.m8); i++) {
+		hash = (hash << 8) | eui64.m8[i];
+	}
+
+	/* MurmurHash3 finalizer, boards from one batch have consecutive
+	 * serials and a weaker mix leaves their phases clustered.
+	 */
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	return hash % period_ms;
+}
@@ -13,6 +13,8 @@
 #ifndef __COAP_CLIENT_UTILS_H__
 #define __COAP_CLIENT_UTILS_H__
 
+#include <zephyr/net/net_ip.h>
+
 /** @brief Struct for implementing k_work object as a member of a parent struct 
  * to enable passing of data to the function
  *
@@ -24,11 +26,6 @@ struct work_var_container{
 	char* 		testing_data;	/*Store the testing data here*/
 };
 
-struct work_heater_container{
-	struct k_work 	work_obj; 		/*Store the work object here*/
-	float 		target_temperature;	/*Store the target temp here*/
-};
-
 /** @brief Type indicates function called when OpenThread connection
  *         is established.
  *
@@ -62,6 +59,24 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
 void coap_client_send_sensor_data (uint16_t temperature_data, uint16_t humidity_data);
 
 
+/** @brief Fetch the setpoint from the server right away.
+ *
+ * @note Used to catch up after missing a group setpoint update.
+ */
+void coap_client_refresh_target(void);
+
+/** @brief Send an alarm event to the provisioned server.
+ *
+ * Alarms go out ahead of queued polls as confirmable requests.
+ *
+ * @param[in] text Alarm payload, e.g. "overtemp=0,85.2".
+ *
+ * @retval 0 Alarm queued.
+ * @retval -ENOTSUP Alarms not enabled in this build.
+ * @retval -EINVAL Payload too long for the transmit queue.
+ */
+int coap_client_send_alarm(const char *text);
+
 /** @brief Request for the CoAP server address to pair.
  *
  * @note Enable paring on the CoAP server to get the address.
@@ -76,19 +91,89 @@ void coap_client_send_provisioning_request(void);
 
 bool isProvisioned(void);
 
-/** @brief Function to retrieve value of new target temperature
- *  
- * @note Determined by checking byte-0 of IP address string, which is initialized to 0
- * After provisioning, the first byte is always set.
+/** @brief Check if an address is the one of the provisioned server.
+ *
+ * @param[in] addr IPv6 address to check.
+ */
+bool coap_utils_is_server_addr(const struct in6_addr *addr);
+
+/** @brief Function to retrieve the target temperatures of all zones
+ *
+ * @note All zones come from the same setpoint publication.
 */
-float coap_utils_retrieve_stored_target_temp(void);
+void coap_utils_retrieve_stored_target_temps(float *targets);
+
+/** @brief Store the latest state of a zone, reported with the next
+ *         HeaterNode request.
+ *
+ * @param[in] zone     Zone index.
+ * @param[in] measured Measured temperature in degC.
+ * @param[in] duty     Heater duty in %.
+ */
+void coap_utils_store_zone_state(uint32_t zone, float measured, float duty);
 
 /** @brief Toggle SED to MED and MED to SED modes.
+ *
+ * With CSL enabled the modes cycle MED, SED, SSED (CSL receiver) instead.
  *
  * @note Active when the device is working as Minimal Thread Device.
  */
 void coap_client_toggle_minimal_sleepy_end_device(void);
 
+/** @brief Thread link modes of a Minimal Thread Device. */
+enum coap_client_link_mode {
+	COAP_CLIENT_LINK_MED,	/* Receiver always on */
+	COAP_CLIENT_LINK_SED,	/* Polls the parent for frames */
+	COAP_CLIENT_LINK_SSED,	/* Samples the channel at the CSL period */
+};
+
+/** @brief Switch to a link mode.
+ *
+ * @retval 0        On success.
+ * @retval -ENOTSUP Mode not supported by this build.
+ * @retval -EIO     OpenThread rejected the mode.
+ */
+int coap_client_set_link_mode(enum coap_client_link_mode mode);
+
+/** @brief Set the data poll period of a sleepy end device.
+ *
+ * @param[in] period_ms Poll period in milliseconds, 0 to let OpenThread
+ *                      derive it from the child timeout.
+ *
+ * @retval 0    On success.
+ * @retval -EIO OpenThread rejected the period.
+ */
+int coap_client_set_poll_period(uint32_t period_ms);
+
+/** @brief Set the CSL period used in SSED mode.
+ *
+ * Applied right away if the device is sleepy.
+ *
+ * @param[in] period_ms CSL period in milliseconds.
+ *
+ * @retval 0        On success.
+ * @retval -EINVAL  Period out of range.
+ * @retval -ENOTSUP Built without CSL receiver support.
+ * @retval -EIO     OpenThread rejected the period.
+ */
+int coap_client_set_csl_period(uint32_t period_ms);
+
+/** @brief Get the CSL period in use, 0 when not sampling.
+ */
+uint32_t coap_client_get_csl_period(void);
+
+/** @brief Get the offset of the periodic exchange within its period.
+ *
+ * A slot assigned in the provisioning reply takes precedence. Otherwise
+ * the phase is derived from the factory EUI-64 when enabled, so nodes
+ * powered up together spread over the period.
+ *
+ * @param[in] period_ms Period of the exchange in milliseconds.
+ *
+ * @return Phase in milliseconds, below @p period_ms.
+ */
+uint32_t coap_client_get_phase(uint32_t period_ms);
+
 #endif
 
 /**
@@ -0,0 +1,470 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/openthread.h>
+#include <openthread/coap.h>
+#include <openthread/ip6.h>
+
+#include <stdlib.h>
+
+#include "ambient.h"
+#include "coap_server_client_interface.h"
+#include "coap_client_utils.h"
+#include "coap_server.h"
+#include "node_config.h"
+#include "profile.h"
+#include "setpoint.h"
+#include "trace_recorder.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define TRACE_BLOCK_SZX OT_COAP_OPTION_BLOCK_SZX_256
+#define TRACE_BLOCK_SIZE 256
+#define CONFIG_TEXT_SIZE 256
+
+static otError send_response(otMessage *request,
+			     const otMessageInfo *message_info,
+			     otCoapCode code, otMessage **out)
+{
+	otInstance *instance = openthread_get_default_instance();
+	otMessage *response;
+	otCoapType type;
+	otError error;
+
+	response = otCoapNewMessage(instance, NULL);
+	if (response == NULL) {
+		return OT_ERROR_NO_BUFS;
+	}
+
+	type = (otCoapMessageGetType(request) == OT_COAP_TYPE_CONFIRMABLE) ?
+	       OT_COAP_TYPE_ACKNOWLEDGMENT : OT_COAP_TYPE_NON_CONFIRMABLE;
+
+	error = otCoapMessageInitResponse(response, request, type, code);
+	if (error != OT_ERROR_NONE) {
+		otMessageFree(response);
+		return error;
+	}
+
+	/* Let the caller append options and payload first */
+	if (out) {
+		*out = response;
+		return OT_ERROR_NONE;
+	}
+
+	error = otCoapSendResponse(instance, response, message_info);
+	if (error != OT_ERROR_NONE) {
+		otMessageFree(response);
+	}
+
+	return error;
+}
+
+#if defined(CONFIG_HEATER_TRACE_RECORDER)
+static otError send_trace_block(otMessage *request,
+				const otMessageInfo *message_info)
+{
+	otInstance *instance = openthread_get_default_instance();
+	uint8_t block[TRACE_BLOCK_SIZE];
+	otCoapOptionIterator iterator;
+	uint64_t block2 = TRACE_BLOCK_SZX;
+	otCoapBlockSzx szx;
+	otMessage *response;
+	uint32_t generation;
+	uint32_t num;
+	size_t size;
+	size_t len;
+	bool more;
+	otError error;
+
+	if (otCoapOptionIteratorInit(&iterator, request) == OT_ERROR_NONE &&
+	    otCoapOptionIteratorGetFirstOptionMatching(&iterator,
+						       OT_COAP_OPTION_BLOCK2)) {
+		otCoapOptionIteratorGetOptionUintValue(&iterator, &block2);
+	}
+
+	/* Use the block size asked for, up to our own. A larger request is
+	 * answered with the block holding its offset, at our size.
+	 */
+	szx = MIN(block2 & 0x7, TRACE_BLOCK_SZX);
+	size = otCoapBlockSizeFromExponent(szx);
+	num = (block2 >> 4) * otCoapBlockSizeFromExponent(block2 & 0x7) / size;
+	len = trace_recorder_read(num * size, block, size);
+	more = trace_recorder_size() > (num + 1) * size;
+	trace_recorder_get_state(&generation);
+
+	error = send_response(request, message_info, OT_COAP_CODE_CONTENT,
+			      &response);
+	if (error != OT_ERROR_NONE) {
+		return error;
+	}
+
+	/* The ETag changes whenever the trace does, so a client can restart
+	 * a transfer that straddled an update.
+	 */
+	error = otCoapMessageAppendOption(response, OT_COAP_OPTION_E_TAG,
+					  sizeof(generation), &generation);
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendContentFormatOption(
+			response, OT_COAP_OPTION_CONTENT_FORMAT_OCTET_STREAM);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendBlock2Option(response, num, more,
+							szx);
+	}
+	if (error == OT_ERROR_NONE && len) {
+		error = otCoapMessageSetPayloadMarker(response);
+	}
+	if (error == OT_ERROR_NONE && len) {
+		error = otMessageAppend(response, block, len);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapSendResponse(instance, response, message_info);
+	}
+	if (error != OT_ERROR_NONE) {
+		otMessageFree(response);
+	}
+
+	return error;
+}
+
+static void on_trace_request(void *context, otMessage *message,
+			     const otMessageInfo *message_info)
+{
+	otError error;
+
+	ARG_UNUSED(context);
+
+	switch (otCoapMessageGetCode(message)) {
+	case OT_COAP_CODE_GET:
+		error = send_trace_block(message, message_info);
+		break;
+
+	case OT_COAP_CODE_POST:
+		trace_recorder_trigger(TRACE_TRIGGER_MANUAL);
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_CHANGED, NULL);
+		break;
+
+	case OT_COAP_CODE_DELETE:
+		trace_recorder_clear();
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_DELETED, NULL);
+		break;
+
+	default:
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_METHOD_NOT_ALLOWED, NULL);
+		break;
+	}
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' response: %d", HEATER_TRACE_URI_PATH,
+			error);
+	}
+}
+
+#endif /* CONFIG_HEATER_TRACE_RECORDER */
+
+#if defined(CONFIG_HEATER_CONFIG_RESOURCE)
+static otError send_config(otMessage *request,
+			   const otMessageInfo *message_info)
+{
+	otInstance *instance = openthread_get_default_instance();
+	char text[CONFIG_TEXT_SIZE];
+	otMessage *response;
+	otError error;
+	int len;
+
+	len = node_config_format(text, sizeof(text));
+	len = MIN(len, sizeof(text) - 1);
+
+	error = send_response(request, message_info, OT_COAP_CODE_CONTENT,
+			      &response);
+	if (error != OT_ERROR_NONE) {
+		return error;
+	}
+
+	error = otCoapMessageAppendContentFormatOption(
+		response, OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN);
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageSetPayloadMarker(response);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otMessageAppend(response, text, len);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapSendResponse(instance, response, message_info);
+	}
+	if (error != OT_ERROR_NONE) {
+		otMessageFree(response);
+	}
+
+	return error;
+}
+
+static void on_config_request(void *context, otMessage *message,
+			      const otMessageInfo *message_info)
+{
+	char text[CONFIG_TEXT_SIZE] = {0};
+	uint16_t len;
+	otCoapCode code;
+	otError error;
+	int ret;
+
+	ARG_UNUSED(context);
+
+	switch (otCoapMessageGetCode(message)) {
+	case OT_COAP_CODE_GET:
+		error = send_config(message, message_info);
+		break;
+
+	case OT_COAP_CODE_PUT:
+	case OT_COAP_CODE_POST:
+		/* Only the server we were provisioned with may reconfigure */
+		len = otMessageGetLength(message) - otMessageGetOffset(message);
+		if (!coap_utils_is_server_addr((const struct in6_addr *)
+					       &message_info->mPeerAddr)) {
+			code = OT_COAP_CODE_FORBIDDEN;
+		} else if (len == 0) {
+			code = OT_COAP_CODE_BAD_REQUEST;
+		} else if (len >= sizeof(text)) {
+			/* Never apply the head of a truncated request */
+			code = OT_COAP_CODE_REQUEST_TOO_LARGE;
+		} else {
+			otMessageRead(message, otMessageGetOffset(message), text,
+				      len);
+			ret = node_config_set(text);
+			code = (ret == 0) ? OT_COAP_CODE_CHANGED :
+			       (ret == -ENOTSUP) ? OT_COAP_CODE_NOT_IMPLEMENTED :
+			       OT_COAP_CODE_BAD_REQUEST;
+		}
+		error = send_response(message, message_info, code, NULL);
+		break;
+
+	default:
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_METHOD_NOT_ALLOWED, NULL);
+		break;
+	}
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' response: %d", NODE_CONFIG_URI_PATH,
+			error);
+	}
+}
+#endif /* CONFIG_HEATER_CONFIG_RESOURCE */
+
+#if defined(CONFIG_HEATER_SETPOINT_RESOURCE)
+#if defined(CONFIG_HEATER_GROUP_SETPOINT)
+/* Sequence number of the last group update, valid once one was received */
+static uint32_t group_sequence;
+static bool group_synced;
+
+/* Strip the "<sequence>:" prefix of a group update and check for gaps */
+static int group_update_check(char **text)
+{
+	uint32_t sequence;
+	int32_t delta;
+	char *end;
+
+	sequence = strtoul(*text, &end, 10);
+	if (end == *text || *end != ':') {
+		return -EINVAL;
+	}
+	*text = end + 1;
+
+	delta = (int32_t)(sequence - group_sequence);
+
+	/* Repeated or reordered update, a newer one was applied already.
+	 * A large step back means the server restarted its count.
+	 */
+	if (group_synced && delta <= 0 &&
+	    delta > -CONFIG_HEATER_GROUP_SEQUENCE_WINDOW) {
+		return -EALREADY;
+	}
+
+	if (group_synced && delta > 1) {
+		LOG_WRN("Missed %d group setpoint updates", delta - 1);
+		coap_client_refresh_target();
+	}
+
+	group_sequence = sequence;
+	group_synced = true;
+
+	return 0;
+}
+#endif
+
+static void on_setpoint_request(void *context, otMessage *message,
+				const otMessageInfo *message_info)
+{
+	char text[8 * CONFIG_HEATER_ZONE_COUNT + 20] = {0};
+	char *targets_text = text;
+	float targets[CONFIG_HEATER_ZONE_COUNT];
+	otCoapCode code = OT_COAP_CODE_CHANGED;
+	uint16_t len;
+	int count;
+
+	ARG_UNUSED(context);
+
+	if (otCoapMessageGetCode(message) != OT_COAP_CODE_PUT) {
+		code = OT_COAP_CODE_METHOD_NOT_ALLOWED;
+		goto exit;
+	}
+
+	/* Only the server we were provisioned with may push setpoints */
+	if (!coap_utils_is_server_addr((const struct in6_addr *)
+				       &message_info->mPeerAddr)) {
+		code = OT_COAP_CODE_FORBIDDEN;
+		goto exit;
+	}
+
+	len = otMessageGetLength(message) - otMessageGetOffset(message);
+	if (len >= sizeof(text)) {
+		/* Never apply the head of a truncated request */
+		code = OT_COAP_CODE_REQUEST_TOO_LARGE;
+		goto exit;
+	}
+
+	otMessageRead(message, otMessageGetOffset(message), text, len);
+
+#if defined(CONFIG_HEATER_GROUP_SETPOINT)
+	/* Group updates carry a sequence number to spot lost ones */
+	if (message_info->mSockAddr.mFields.m8[0] == 0xff) {
+		int ret = group_update_check(&targets_text);
+
+		if (ret == -EALREADY) {
+			goto exit;
+		} else if (ret) {
+			code = OT_COAP_CODE_BAD_REQUEST;
+			goto exit;
+		}
+	}
+#endif
+
+	count = setpoint_parse(targets_text, targets);
+	if (count < 0) {
+		code = OT_COAP_CODE_BAD_REQUEST;
+		goto exit;
+	}
+
+	if (IS_ENABLED(CONFIG_HEATER_PROFILE)) {
+		profile_stop();
+	}
+
+	setpoint_publish(targets, count);
+	LOG_INF("Pushed setpoint: %s", text);
+
+exit:
+	/* Only a confirmable request needs an answer */
+	if (otCoapMessageGetType(message) == OT_COAP_TYPE_CONFIRMABLE &&
+	    send_response(message, message_info, code, NULL) != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' response", HEATER_SETPOINT_URI_PATH);
+	}
+}
+#endif /* CONFIG_HEATER_SETPOINT_RESOURCE */
+
+#if defined(CONFIG_HEATER_AMBIENT_BINDING)
+/* Readings sensor nodes send to the binding group, "<temp>/<humidity>" */
+static void on_sensor_reading(void *context, otMessage *message,
+			      const otMessageInfo *message_info)
+{
+	char text[24] = {0};
+	float temperature, humidity;
+	char *end;
+
+	ARG_UNUSED(context);
+
+	if (otCoapMessageGetCode(message) != OT_COAP_CODE_PUT) {
+		return;
+	}
+
+	otMessageRead(message, otMessageGetOffset(message), text,
+		      sizeof(text) - 1);
+
+	temperature = strtof(text, &end);
+	if (end == text || *end != '/') {
+		LOG_WRN("Invalid sensor reading: %s", text);
+		return;
+	}
+	humidity = strtof(end + 1, NULL);
+
+	ambient_update(message_info->mPeerAddr.mFields.m8, temperature,
+		       humidity);
+}
+#endif /* CONFIG_HEATER_AMBIENT_BINDING */
+
+static otCoapResource resources[] = {
+#if defined(CONFIG_HEATER_CONFIG_RESOURCE)
+	{
+		.mUriPath = NODE_CONFIG_URI_PATH,
+		.mHandler = on_config_request,
+	},
+#endif
+#if defined(CONFIG_HEATER_TRACE_RECORDER)
+	{
+		.mUriPath = HEATER_TRACE_URI_PATH,
+		.mHandler = on_trace_request,
+	},
+#endif
+#if defined(CONFIG_HEATER_SETPOINT_RESOURCE)
+	{
+		.mUriPath = HEATER_SETPOINT_URI_PATH,
+		.mHandler = on_setpoint_request,
+	},
+#endif
+#if defined(CONFIG_HEATER_AMBIENT_BINDING)
+	{
+		.mUriPath = NODE1_URI_PATH,
+		.mHandler = on_sensor_reading,
+	},
+#endif
+};
+
+static const char *const groups[] = {
+#if defined(CONFIG_HEATER_GROUP_SETPOINT)
+	CONFIG_HEATER_GROUP_ADDR,
+#endif
+#if defined(CONFIG_HEATER_AMBIENT_BINDING)
+	CONFIG_HEATER_AMBIENT_GROUP_ADDR,
+#endif
+};
+
+int coap_server_init(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otError error;
+
+	openthread_api_mutex_lock(context);
+
+	error = otCoapStart(context->instance, OT_DEFAULT_COAP_PORT);
+	if (error == OT_ERROR_NONE) {
+		for (int i = 0; i < ARRAY_SIZE(resources); i++) {
+			otCoapAddResource(context->instance, &resources[i]);
+		}
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(groups) && error == OT_ERROR_NONE; i++) {
+		otIp6Address group;
+
+		error = otIp6AddressFromString(groups[i], &group);
+		if (error == OT_ERROR_NONE) {
+			error = otIp6SubscribeMulticastAddress(context->instance,
+							       &group);
+		}
+	}
+
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to start CoAP server: %d", error);
+		return -EIO;
+	}
+
+	return 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * @file
+ * @defgroup coap_server CoAP resources served by the heater
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __COAP_SERVER_H__
+#define __COAP_SERVER_H__
+
+/** @brief Start the OpenThread CoAP service and register the heater resources.
+ *
+ * @note OpenThread must be started before.
+ *
+ * @retval 0    On success.
+ * @retval != 0 On failure.
+ */
+int coap_server_init(void);
+
+#endif
+
+/**
+ * @}
+ */
@@ -12,6 +12,30 @@
 #define PROVISIONING_URI_PATH "provisioning" 
 #define NODE1_URI_PATH "SensorNode1" 
 #define NODE2_URI_PATH "SensorNode2" 
+/* The heater FETCHes HeaterNode with "<measured>,<duty>;..." per zone and
+ * gets "<target>[;<target>...]" back, a single target drives all zones.
+ */
 #define HEATER_URI_PATH "HeaterNode"
 
+/* Served by the heater: PUT "<target>[;<target>...]" to push setpoints */
+#define HEATER_SETPOINT_URI_PATH "setpoint"
+
+/* Served by the heater: GET the frozen PID trace, POST to freeze, DELETE to re-arm */
+#define HEATER_TRACE_URI_PATH "HeaterTrace"
+
+/* Served by the heater: GET or PUT "<key>=<value>;..." runtime parameters */
+#define NODE_CONFIG_URI_PATH "config"
+
+/* Alarm events are POSTed confirmable, e.g. "overtemp=<zone>,<measured>" */
+#define ALARM_URI_PATH "alarm"
+
+/* HeaterNode reply asking the heater to auto-tune its PID gains */
+#define HEATER_CMD_AUTOTUNE "tune"
+
+/* HeaterNode reply asking the heater to download its ramp/soak profile.
+ * HeaterProfile replies with "<zone>,<target>,<degC/min>,<hold s>;..."
+ */
+#define HEATER_CMD_PROFILE "profile"
+#define HEATER_PROFILE_URI_PATH "HeaterProfile"
+
 #endif
\ No newline at end of file
@@ -0,0 +1,115 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "heater_gains.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define GAINS_SETTINGS_KEY "heater/gains"
+
+/* Hand tuned on the first rig, Ku = 32.0 */
+#define DEFAULT_GAINS { .k_p = 19.2f, .k_i = 0.0f, .k_d = 6.0f }
+
+static struct pid_gains zone_gains[CONFIG_HEATER_ZONE_COUNT] = {
+	[0 ... CONFIG_HEATER_ZONE_COUNT - 1] = DEFAULT_GAINS
+};
+static struct k_spinlock gains_lock;
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int gains_settings_set(const char *name, size_t len,
+			      settings_read_cb read_cb, void *cb_arg)
+{
+	struct pid_gains gains;
+	unsigned long zone;
+	char *end;
+	int ret;
+
+	zone = strtoul(name, &end, 10);
+	if (end == name || zone >= CONFIG_HEATER_ZONE_COUNT ||
+	    len != sizeof(gains)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &gains, sizeof(gains));
+	if (ret < 0) {
+		return ret;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&gains_lock);
+
+	zone_gains[zone] = gains;
+	k_spin_unlock(&gains_lock, key);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(heater_gains, GAINS_SETTINGS_KEY, NULL,
+			       gains_settings_set, NULL, NULL);
+#endif
+
+void heater_gains_init(void)
+{
+#if IS_ENABLED(CONFIG_SETTINGS)
+	int ret = settings_subsys_init();
+
+	if (!ret) {
+		ret = settings_load_subtree(GAINS_SETTINGS_KEY);
+	}
+	if (ret) {
+		LOG_ERR("Cannot load PID gains, (error: %d)", ret);
+	}
+#endif
+}
+
+void heater_gains_get(uint32_t zone, struct pid_gains *gains)
+{
+	__ASSERT_NO_MSG(zone < CONFIG_HEATER_ZONE_COUNT);
+
+	k_spinlock_key_t key = k_spin_lock(&gains_lock);
+
+	*gains = zone_gains[zone];
+	k_spin_unlock(&gains_lock, key);
+}
+
+int heater_gains_set(uint32_t zone, const struct pid_gains *gains)
+{
+	if (zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return -EINVAL;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&gains_lock);
+
+	zone_gains[zone] = *gains;
+	k_spin_unlock(&gains_lock, key);
+
+	return 0;
+}
+
+int heater_gains_save(uint32_t zone)
+{
+	if (zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return -EINVAL;
+	}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	char name[sizeof(GAINS_SETTINGS_KEY "/255")];
+	struct pid_gains gains;
+
+	heater_gains_get(zone, &gains);
+	snprintf(name, sizeof(name), GAINS_SETTINGS_KEY "/%u", zone);
+
+	return settings_save_one(name, &gains, sizeof(gains));
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,47 @@
+/**
+ * @file
+ * @defgroup heater_gains Persistent per-zone PID gains
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __HEATER_GAINS_H__
+#define __HEATER_GAINS_H__
+
+#include "pid.h"
+
+/** @brief Load the stored gains, zones without stored gains use the defaults.
+ */
+void heater_gains_init(void);
+
+/** @brief Get the gains of a zone.
+ */
+void heater_gains_get(uint32_t zone, struct pid_gains *gains);
+
+/** @brief Set the gains of a zone, they are not stored until heater_gains_save().
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL Unknown zone.
+ */
+int heater_gains_set(uint32_t zone, const struct pid_gains *gains);
+
+/** @brief Persist the current gains of a zone.
+ *
+ * Writes to flash, so keep it out of latency sensitive paths.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL Unknown zone.
+ * @retval < 0     Storing the gains failed.
+ */
+int heater_gains_save(uint32_t zone);
+
+#endif
+
+/**
+ * @}
+ */
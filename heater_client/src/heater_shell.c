@@ -0,0 +1,313 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ambient.h"
+#include "autotune.h"
+#include "coap_client_utils.h"
+#include "heater_gains.h"
+#include "node_config.h"
+#include "oscore_client.h"
+#include "profile.h"
+#include "telemetry.h"
+#include "trace_recorder.h"
+#include "tx_queue.h"
+
+static const char *const autotune_state_str[] = {
+	[AUTOTUNE_IDLE] = "idle",
+	[AUTOTUNE_REQUESTED] = "requested",
+	[AUTOTUNE_RUNNING] = "running",
+	[AUTOTUNE_DONE] = "done",
+	[AUTOTUNE_FAILED] = "failed",
+};
+
+/* Parse a zone index or "all" into the first and last zone to act on */
+static int parse_zones(const struct shell *sh, const char *arg,
+		       uint32_t *first, uint32_t *last)
+{
+	char *end;
+	unsigned long zone;
+
+	if (!strcmp(arg, "all")) {
+		*first = 0;
+		*last = CONFIG_HEATER_ZONE_COUNT - 1;
+		return 0;
+	}
+
+	zone = strtoul(arg, &end, 10);
+	if (*end != '\0' || zone >= CONFIG_HEATER_ZONE_COUNT) {
+		shell_error(sh, "Invalid zone: %s", arg);
+		return -EINVAL;
+	}
+
+	*first = zone;
+	*last = zone;
+
+	return 0;
+}
+
+static int cmd_tune_start(const struct shell *sh, size_t argc, char **argv)
+{
+	float setpoint = AUTOTUNE_CURRENT_TARGET;
+	uint32_t first, last;
+	int ret;
+
+	if (parse_zones(sh, argv[1], &first, &last)) {
+		return -EINVAL;
+	}
+
+	if (argc > 2) {
+		setpoint = strtof(argv[2], NULL);
+	}
+
+	for (uint32_t zone = first; zone <= last; zone++) {
+		ret = autotune_start(zone, setpoint);
+		if (ret) {
+			shell_error(sh, "Zone %d: cannot start (%d)", zone, ret);
+		}
+	}
+
+	return 0;
+}
+
+static int cmd_tune_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t first, last;
+
+	if (parse_zones(sh, argv[1], &first, &last)) {
+		return -EINVAL;
+	}
+
+	for (uint32_t zone = first; zone <= last; zone++) {
+		autotune_abort(zone);
+	}
+
+	return 0;
+}
+
+static int cmd_status(const struct shell *sh, size_t argc, char **argv)
+{
+	struct pid_gains gains;
+	enum autotune_state state;
+	float ku, tu;
+
+	for (uint32_t zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		heater_gains_get(zone, &gains);
+		state = autotune_get_state(zone, &ku, &tu);
+
+		shell_print(sh, "zone %d: k_p %f k_i %f k_d %f, tune %s (Ku %f Tu %f s)",
+			    zone, gains.k_p, gains.k_i, gains.k_d,
+			    autotune_state_str[state], ku, tu);
+	}
+
+	if (IS_ENABLED(CONFIG_HEATER_TELEMETRY)) {
+		uint32_t sent, dropped;
+
+		telemetry_get_stats(&sent, &dropped);
+		shell_print(sh, "telemetry: %u records sent, %u dropped",
+			    sent, dropped);
+	}
+
+	if (!IS_ENABLED(CONFIG_HEATER_THERMAL_SIM)) {
+		struct tx_queue_stats tx;
+
+		tx_queue_get_stats(&tx);
+		shell_print(sh, "tx queue: %u queued, %u sent, %u coalesced, %u dropped",
+			    tx.queued, tx.sent, tx.coalesced, tx.dropped);
+	}
+
+	if (IS_ENABLED(CONFIG_COAP_CLIENT_OSCORE)) {
+		struct oscore_client_stats st;
+
+		oscore_client_get_stats(&st);
+		shell_print(sh, "oscore: %s, %u requests (%u timed out), %u responses (%u rejected)",
+			    oscore_client_is_ready() ? "ready" : "not provisioned",
+			    st.requests, st.timeouts, st.responses, st.rejected);
+		shell_print(sh, "oscore: %u plain, %u protected bytes, %u us protecting, %u us verifying",
+			    st.plain_bytes, st.protected_bytes, st.protect_us,
+			    st.unprotect_us);
+		shell_print(sh, "oscore: %u ms total, %u ms max round trip",
+			    st.rtt_ms, st.rtt_max_ms);
+	}
+
+	if (IS_ENABLED(CONFIG_HEATER_AMBIENT_BINDING)) {
+		float ambient;
+
+		if (ambient_get(&ambient)) {
+			shell_print(sh, "ambient: %f degC from %d sensors", ambient,
+				    ambient_source_count());
+		} else {
+			shell_print(sh, "ambient: no bound sensor heard");
+		}
+	}
+
+	if (IS_ENABLED(CONFIG_HEATER_TRACE_RECORDER)) {
+		static const char *const trace_state_str[] = {
+			[TRACE_RUNNING] = "running",
+			[TRACE_TRIGGERED] = "triggered",
+			[TRACE_FROZEN] = "frozen",
+		};
+		uint32_t generation;
+		enum trace_state state = trace_recorder_get_state(&generation);
+
+		shell_print(sh, "trace: %s, %zu bytes, generation %u",
+			    trace_state_str[state], trace_recorder_size(),
+			    generation);
+	}
+
+	return 0;
+}
+
+static int cmd_config(const struct shell *sh, size_t argc, char **argv)
+{
+	char text[256] = {0};
+	int ret;
+
+	if (argc == 1) {
+		node_config_format(text, sizeof(text));
+
+		for (char *save, *item = strtok_r(text, ";", &save); item;
+		     item = strtok_r(NULL, ";", &save)) {
+			shell_print(sh, "%s", item);
+		}
+
+		return 0;
+	}
+
+	/* Apply all assignments together, or none of them */
+	for (size_t i = 1; i < argc; i++) {
+		if (strlen(text) + strlen(argv[i]) + 2 > sizeof(text)) {
+			shell_error(sh, "Too many parameters");
+			return -EINVAL;
+		}
+		if (i > 1) {
+			strcat(text, ";");
+		}
+		strcat(text, argv[i]);
+	}
+
+	ret = node_config_set(text);
+	if (ret) {
+		shell_error(sh, "Cannot set configuration (%d)", ret);
+	}
+
+	return ret;
+}
+
+#if defined(CONFIG_HEATER_PROFILE)
+static int cmd_profile_load(const struct shell *sh, size_t argc, char **argv)
+{
+	static struct profile parsed;
+	int ret = profile_load(argv[1], strlen(argv[1]), &parsed);
+
+	if (ret) {
+		shell_error(sh, "Invalid profile (%d)", ret);
+	}
+
+	return ret;
+}
+
+static int cmd_profile_stop(const struct shell *sh, size_t argc, char **argv)
+{
+	profile_stop();
+
+	return 0;
+}
+
+static int cmd_profile_show(const struct shell *sh, size_t argc, char **argv)
+{
+	uint32_t segment, count;
+	bool running;
+
+	for (uint32_t zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		running = profile_get_progress(zone, &segment, &count);
+		shell_print(sh, "zone %d: %s, segment %d of %d", zone,
+			    running ? "running" : "idle", segment, count);
+	}
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_profile,
+	SHELL_CMD_ARG(load, NULL, "<zone,target,rate,hold;...> Run a ramp/soak profile",
+		      cmd_profile_load, 2, 0),
+	SHELL_CMD(stop, NULL, "Drop the profile and follow the server again",
+		  cmd_profile_stop),
+	SHELL_CMD(show, NULL, "Show the profile progress", cmd_profile_show),
+	SHELL_SUBCMD_SET_END
+);
+#define SUB_PROFILE (&sub_profile)
+#else
+#define SUB_PROFILE NULL
+#endif
+
+#if !defined(CONFIG_HEATER_THERMAL_SIM)
+static int cmd_mode(const struct shell *sh, size_t argc, char **argv)
+{
+	if (!IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		shell_error(sh, "Not built as a sleepy end device");
+		return -ENOTSUP;
+	}
+
+	coap_client_toggle_minimal_sleepy_end_device();
+
+	return 0;
+}
+
+static int cmd_csl(const struct shell *sh, size_t argc, char **argv)
+{
+	int ret;
+
+	if (argc > 1) {
+		ret = coap_client_set_csl_period(strtoul(argv[1], NULL, 10));
+		if (ret) {
+			shell_error(sh, "Cannot set CSL period (%d)", ret);
+			return ret;
+		}
+	}
+
+	shell_print(sh, "CSL period: %u ms", coap_client_get_csl_period());
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_link,
+	SHELL_CMD(mode, NULL, "Cycle the MED, SED and SSED link modes", cmd_mode),
+	SHELL_CMD_ARG(csl, NULL, "[period ms] Show or set the SSED CSL period",
+		      cmd_csl, 1, 1),
+	SHELL_SUBCMD_SET_END
+);
+#define SUB_LINK (&sub_link)
+#else
+#define SUB_LINK NULL
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_tune,
+	SHELL_CMD_ARG(start, NULL, "<zone|all> [setpoint] Start a relay experiment",
+		      cmd_tune_start, 2, 1),
+	SHELL_CMD_ARG(stop, NULL, "<zone|all> Abort a relay experiment",
+		      cmd_tune_stop, 2, 0),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_heater,
+	SHELL_CMD(tune, &sub_tune, "PID auto-tuning", NULL),
+	SHELL_EXPR_CMD(!IS_ENABLED(CONFIG_HEATER_THERMAL_SIM), link, SUB_LINK,
+		       "Thread link mode", NULL),
+	SHELL_COND_CMD(CONFIG_HEATER_PROFILE, profile, SUB_PROFILE,
+		       "Setpoint ramp/soak profiles", NULL),
+	SHELL_CMD(status, NULL, "Show gains and auto-tuning state", cmd_status),
+	SHELL_CMD_ARG(config, NULL, "[key=value ...] Show or set the runtime configuration",
+		      cmd_config, 1, 14),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(heater, &sub_heater, "Heater control commands", NULL);
@@ -22,15 +22,29 @@ LOG_MODULE_DECLARE(coap_client_utils);
 /*Coap client stuff*/
 #include "coap_client.h                                                        "
 
+#include "ambient.h"
+#include "autotune.h"
+#include "heater_gains.h"
+#include "hot_path_log.h"
+#include "node_config.h"
+#include "pid.h"
+#include "pipeline_trace.h"
+#include "profile.h"
+#include "setpoint.h"
+#include "telemetry.h"
+#include "trace_recorder.h"
+
 #include <stdlib.h>
 #include <time.h>
 
-/* 1000 msec = 1 sec */
-#define SLEEP_TIME_MS  1350
-
 /* The devicetree node identifier for the "led0" alias. */
 #define LED1_NODE DT_ALIAS(led1)
 
+#define HEATER_CHANNEL_COUNT 3
+
+/* Readings above this are treated as a thermocouple comms error */
+#define COMMS_ERROR_TEMP 50
+
 /*
  * A build error on this line means your board is unsupported.
  * See the sample documentation for information on how to fix this.
@@ -38,6 +52,36 @@ LOG_MODULE_DECLARE(coap_client_utils);
 
 static const struct gpio_dt_spec led = GPIO_DT_SPEC_GET(LED1_NODE, gpios);
 
+struct heater_zone {
+	const struct device *thermocouple;
+	uint32_t channels;	/* Mask of the PWM channels heating this zone */
+	struct pid_ctrl pid;
+	float temperature;
+	float target;
+	float duty;
+};
+
+/* With a single zone the first thermocouple drives all heaters */
+static struct heater_zone zones[CONFIG_HEATER_ZONE_COUNT] = {
+	{
+		.thermocouple = DEVICE_DT_GET(DT_NODELABEL(a)),
+		.channels = (CONFIG_HEATER_ZONE_COUNT == 1) ?
+			    BIT_MASK(HEATER_CHANNEL_COUNT) : BIT(0),
+	},
+#if CONFIG_HEATER_ZONE_COUNT > 1
+	{
+		.thermocouple = DEVICE_DT_GET(DT_NODELABEL(b)),
+		.channels = BIT(1),
+	},
+#endif
+#if CONFIG_HEATER_ZONE_COUNT > 2
+	{
+		.thermocouple = DEVICE_DT_GET(DT_NODELABEL(c)),
+		.channels = BIT(2),
+	},
+#endif
+};
+
 
 // PWM function
 void heater_setting(const struct device *dev, float duty, uint8_t channel){
@@ -70,8 +114,67 @@ void heater_setting(const struct device *dev, float duty, uint8_t channel){
 }
 
 
+static int read_temperature(struct heater_zone *zone)
+{
+	struct sensor_value val;
+	int ret;
+
+	PIPELINE_TRACE(TRACE_TEMP_START, zone - zones, 0);
+	ret = sensor_sample_fetch_chan(zone->thermocouple, SENSOR_CHAN_AMBIENT_TEMP);
+	if (ret < 0) {
+		printk("Could not fetch temperature (%d)\n", ret);
+		return ret;
+	}
+
+	ret = sensor_channel_get(zone->thermocouple, SENSOR_CHAN_AMBIENT_TEMP, &val);
+	if (ret < 0) {
+		printk("Could not get temperature (%d)\n", ret);
+		return ret;
+	}
+
+	zone->temperature = sensor_value_to_double(&val);
+	PIPELINE_TRACE(TRACE_TEMP_DONE, zone - zones, zone->temperature * 100);
+
+	return 0;
+}
+
+static void control_zone(uint32_t index, float target, float dt, int64_t now)
+{
+	struct heater_zone *zone = &zones[index];
+	float error = target - zone->temperature;
+
+	if (autotune_is_active(index)) {
+		zone->duty = autotune_step(index, zone->temperature, target, now);
+		pid_reset(&zone->pid, error);
+		return;
+	}
+
+	/* Pick up gains changed by the auto-tuner or the shell */
+	heater_gains_get(index, &zone->pid.gains);
+
+	if (zone->temperature > COMMS_ERROR_TEMP) {
+		pid_reset_integral(&zone->pid); // reset i if comms error
+	}
+
+	zone->duty = pid_update(&zone->pid, error, dt);
+
+#if defined(CONFIG_HEATER_AMBIENT_BINDING)
+	float ambient;
+
+	/* Cover the losses to the room up front, the PID trims the rest */
+	if (ambient_get(&ambient) && target > ambient) {
+		zone->duty = CLAMP(zone->duty + (target - ambient) *
+				   CONFIG_HEATER_FEEDFORWARD_MILLI / 1000.0f,
+				   0, 100);
+	}
+#endif
+}
+
 void main(void)
 {	
+	/* Runtime parameters are needed before the transport comes up */
+	node_config_init();
+
 	/*Init coap fuckery*/
 	coap_client_init();
 
@@ -90,21 +193,15 @@ void main(void)
 
 	const struct device *heater1 = DEVICE_DT_GET(DT_NODELABEL(pwm0));
 
-	/* CONFIGURE SPI FOR THERMOCOUPLES */
-	const struct device *thermocouple_1 = DEVICE_DT_GET(DT_NODELABEL(a));
-	struct sensor_value val1;
-	const struct device *dev2 = DEVICE_DT_GET(DT_NODELABEL(b));
-	struct sensor_value val2;
-	const struct device *dev3 = DEVICE_DT_GET(DT_NODELABEL(c));
-	struct sensor_value val3;
-
 	/*USB fuckery starts here*/
+#if IS_ENABLED(CONFIG_USB_DEVICE_STACK)
 	const struct device *usb_dev = DEVICE_DT_GET(DT_CHOSEN(zephyr_shell_uart));
 	uint32_t dtr = 0;
 
 	if (usb_enable(NULL)) {
 		return;
 	}
+#endif
 
 	/* Poll if the DTR flag was set */
 	// while (!dtr) {
@@ -115,9 +212,11 @@ void main(void)
 
 	/*USB fuckery ends here*/
 
-	if (!device_is_ready(thermocouple_1)) {
-		printk("sensor: device not ready.\n");
-		return;
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		if (!device_is_ready(zones[z].thermocouple)) {
+			printk("sensor: device not ready.\n");
+			return;
+		}
 	}
 
 	int ret;
@@ -131,73 +230,104 @@ void main(void)
 		return;
 	}
 
-	float target;
-	float error, previous_error;
-	float p, i, d;
-	i = 0; // set integral to 0 a t the beginning
-	// Ku = 32.0
-	float k_p = 19.2;
-	float k_i = 0;
-	float k_d = 6;
-	float duty;
+	if (IS_ENABLED(CONFIG_HEATER_TELEMETRY)) {
+		ret = telemetry_init();
+		if (ret < 0) {
+			return;
+		}
+	}
 
-	float elapsed_time = 1.35+0.02+0.02+0.02;
+	/* Gains are tuned per zone and kept across reboots */
+	heater_gains_init();
 
-	while (1) {
-		/*Target temp retrieval*/
-		target = retrieve_stored_target_temp();
+	float targets[CONFIG_HEATER_ZONE_COUNT];
 
-		/* Getting the temperature */
-		int ret1;
+	retrieve_stored_target_temps(targets);
 
-		ret1 = sensor_sample_fetch_chan(thermocouple_1, SENSOR_CHAN_AMBIENT_TEMP);
-		if (ret1 < 0) {
-			printk("Could not fetch temperature (%d)\n", ret);
-			return;
-		}
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		struct pid_gains gains;
 
-		ret1 = sensor_channel_get(thermocouple_1, SENSOR_CHAN_AMBIENT_TEMP, &val1);
-		if (ret1 < 0) {
-			printk("Could not get temperature (%d)\n", ret);
-			return;
+		heater_gains_get(z, &gains);
+		pid_init(&zones[z].pid, &gains, 0, 100);
+		zones[z].target = targets[z];
+	}
+
+	float elapsed_time;
+	int64_t last_run = k_uptime_get() -
+			   node_config_get(NODE_CONFIG_CONTROL) - 60;
+
+	while (1) {
+		/* Getting the temperatures */
+		for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+			ret = read_temperature(&zones[z]);
+			if (ret < 0) {
+				return;
+			}
 		}
 
 		k_msleep(20); // Wait for 10ms for getting values
-
-		double one = sensor_value_to_double(&val1);
 		k_msleep(20); // Wait for 10ms for calculations
 
-		// PID stuff
-		error = target-one;
-		p = error;
-		i = i + error*elapsed_time; //dt = 20ms + 20ms + 20ms + 1350ms
-		if (abs(i) > 30){
-			if(i > 0)
-				i = 30;
-			else
-				i = -30;
-		}
+		int64_t now = k_uptime_get();
 
-		if(one > 50)
-			i = 0; // reset i if comms error
+		/* The loop wakes early on a setpoint change, so measure dt */
+		elapsed_time = (now - last_run) / 1000.0f;
+		last_run = now;
 
-		d = (error-previous_error)/elapsed_time;
+		/*Target temp retrieval, all zones from the same update*/
+		retrieve_stored_target_temps(targets);
 
-		duty = k_p*p + k_i*i + k_d*d;
-		if(duty >= 100)
-			duty = 100;
-		else if (duty < 0)
-			duty = 0;
+		for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+			float zone_target = targets[z];
+
+			if (IS_ENABLED(CONFIG_HEATER_PROFILE)) {
+				zone_target = profile_get_target(z, now,
+								 zones[z].temperature,
+								 zone_target);
+			}
+
+			pid_setpoint_changed(&zones[z].pid,
+					     zone_target - zones[z].target);
+			zones[z].target = zone_target;
+
+			control_zone(z, zones[z].target, elapsed_time, now);
+		}
 
-		previous_error = error;
 		k_msleep(20); // Wait for 10ms for getting values
 
-		heater_setting(heater1, duty, 0);
-		heater_setting(heater1, duty, 1);
-		heater_setting(heater1, duty, 2);
+		struct trace_zone_sample samples[CONFIG_HEATER_ZONE_COUNT];
+
+		for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+			for (uint8_t ch = 0; ch < HEATER_CHANNEL_COUNT; ch++) {
+				if (zones[z].channels & BIT(ch)) {
+					heater_setting(heater1, zones[z].duty, ch);
+				}
+			}
+			PIPELINE_TRACE(TRACE_ACTUATE, z, zones[z].duty * 100);
+
+			if (IS_ENABLED(CONFIG_HEATER_TELEMETRY)) {
+				telemetry_record(z, now, zones[z].temperature, zones[z].target,
+						 zones[z].duty,
+						 autotune_is_active(z) ?
+						 TELEMETRY_FLAG_AUTOTUNE : 0);
+			} else if (!IS_ENABLED(CONFIG_HEATER_TRACE_RECORDER)) {
+				HOT_LOG_INF("$%f %f %f;", zones[z].temperature, zones[z].target,
+					zones[z].duty);
+			}
+
+			report_zone_state(z, zones[z].temperature, zones[z].duty);
+
+			samples[z].measured = zones[z].temperature;
+			samples[z].target = zones[z].target;
+			samples[z].duty = zones[z].duty;
+		}
+
+		if (IS_ENABLED(CONFIG_HEATER_TRACE_RECORDER)) {
+			trace_recorder_add(now, samples);
+		}
 
-		LOG_INF("$%f %f %f;", one, target, duty);
+		bool changed = setpoint_wait(K_MSEC(node_config_get(NODE_CONFIG_CONTROL)));
 
-		k_msleep(SLEEP_TIME_MS);
+		PIPELINE_TRACE(TRACE_CTRL_WAKE, changed, 0);
 	}
 }
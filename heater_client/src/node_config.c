@@ -0,0 +1,460 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coap_client_utils.h"
+#include "heater_gains.h"
+#include "node_config.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define NODE_CONFIG_SETTINGS_KEY "heater/config"
+#define NODE_CONFIG_TEXT_MAX 256
+
+/* Thread parameters mean nothing with the simulated transport */
+#define HAS_THREAD !IS_ENABLED(CONFIG_HEATER_THERMAL_SIM)
+
+/* SSED is only there with the CSL receiver built in */
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+#define CSL_PERIOD_DEFAULT CONFIG_COAP_CLIENT_CSL_PERIOD_MS
+#define LINK_MODE_DEFAULT COAP_CLIENT_LINK_SSED
+#define LINK_MODE_MAX COAP_CLIENT_LINK_SSED
+#else
+#define CSL_PERIOD_DEFAULT 0
+#define LINK_MODE_DEFAULT COAP_CLIENT_LINK_SED
+#define LINK_MODE_MAX COAP_CLIENT_LINK_SED
+#endif
+
+#if defined(CONFIG_HEATER_ALARMS)
+#define OVERTEMP_DEFAULT CONFIG_HEATER_ALARM_OVERTEMP
+#else
+#define OVERTEMP_DEFAULT 0
+#endif
+
+struct param {
+	const char *name;
+	int32_t min;
+	int32_t max;
+	int32_t def;
+	bool supported;
+};
+
+static const struct param params[NODE_CONFIG_COUNT] = {
+	[NODE_CONFIG_PERIOD] = {
+		.name = "period",
+		.min = 1000, .max = 3600000,
+		.def = CONFIG_HEATER_SETPOINT_POLL_PERIOD_MS,
+		.supported = HAS_THREAD,
+	},
+	[NODE_CONFIG_POLL] = {
+		.name = "poll",
+		.min = 0, .max = 86400000,
+		.def = 0,
+		.supported = HAS_THREAD && IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED),
+	},
+	[NODE_CONFIG_MODE] = {
+		.name = "mode",
+		.min = COAP_CLIENT_LINK_MED, .max = LINK_MODE_MAX,
+		.def = LINK_MODE_DEFAULT,
+		.supported = HAS_THREAD && IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED),
+	},
+	[NODE_CONFIG_CSL] = {
+		.name = "csl",
+		.min = 1, .max = 10485,
+		.def = CSL_PERIOD_DEFAULT,
+		.supported = HAS_THREAD &&
+			     IS_ENABLED(CONFIG_OPENTHREAD_CSL_RECEIVER),
+	},
+	[NODE_CONFIG_CONTROL] = {
+		.name = "control",
+		/* The MAX6675 converts in up to 220 ms */
+		.min = 250, .max = 60000,
+		.def = CONFIG_HEATER_CONTROL_PERIOD_MS,
+		.supported = true,
+	},
+	[NODE_CONFIG_OVERTEMP] = {
+		.name = "overtemp",
+		/* The MAX6675 reads up to 1023.75 C */
+		.min = 0, .max = 1000,
+		.def = OVERTEMP_DEFAULT,
+		.supported = IS_ENABLED(CONFIG_HEATER_ALARMS),
+	},
+};
+
+static const char *const mode_names[] = {
+	[COAP_CLIENT_LINK_MED] = "med",
+	[COAP_CLIENT_LINK_SED] = "sed",
+	[COAP_CLIENT_LINK_SSED] = "ssed",
+};
+
+static const char gain_names[] = { 'p', 'i', 'd' };
+
+static int32_t values[NODE_CONFIG_COUNT];
+static uint32_t loaded;		/* Parameters restored from settings */
+static atomic_t dirty;		/* Parameters waiting to be stored */
+static atomic_t gains_dirty;	/* Zones with gains waiting to be stored */
+static node_config_changed_cb_t on_change;
+static struct k_work save_work;
+
+static int find_param(const char *name, size_t len)
+{
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (strlen(params[i].name) == len &&
+		    !strncmp(params[i].name, name, len)) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int parse_value(int id, const char *text, int32_t *value)
+{
+	char *end;
+	long parsed;
+
+	parsed = strtol(text, &end, 10);
+
+	/* A link mode may be given by name, it is range checked all the same */
+	for (int i = 0; id == NODE_CONFIG_MODE && i < ARRAY_SIZE(mode_names); i++) {
+		if (!strcmp(text, mode_names[i])) {
+			parsed = i;
+			end = (char *)text + strlen(text);
+		}
+	}
+
+	if (end == text || *end != '\0' ||
+	    parsed < params[id].min || parsed > params[id].max) {
+		return -EINVAL;
+	}
+
+	*value = parsed;
+
+	return 0;
+}
+
+static float *gain_field(struct pid_gains *gains, int index)
+{
+	switch (index) {
+	case 0:
+		return &gains->k_p;
+	case 1:
+		return &gains->k_i;
+	default:
+		return &gains->k_d;
+	}
+}
+
+/* Set one of "kp<zone>", "ki<zone>" or "kd<zone>" in the zone gains */
+static int parse_gain(const char *name, size_t len, const char *text,
+		      struct pid_gains *gains)
+{
+	const char *pos;
+	unsigned long zone;
+	char *end;
+	float gain;
+
+	if (len < 3 || name[0] != 'k') {
+		return -ENOENT;
+	}
+
+	pos = memchr(gain_names, name[1], sizeof(gain_names));
+	if (!pos) {
+		return -ENOENT;
+	}
+
+	zone = strtoul(name + 2, &end, 10);
+	if (end != name + len || zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return -ENOENT;
+	}
+
+	gain = strtof(text, &end);
+	if (end == text || *end != '\0' || !isfinite(gain) || gain < 0) {
+		return -EINVAL;
+	}
+
+	*gain_field(&gains[zone], pos - gain_names) = gain;
+
+	return zone;
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int config_settings_set(const char *name, size_t len,
+			       settings_read_cb read_cb, void *cb_arg)
+{
+	int32_t value;
+	int id = find_param(name, strlen(name));
+	int ret;
+
+	if (id < 0 || len != sizeof(value)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &value, sizeof(value));
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* Ignore values a newer or older build would not accept */
+	if (!params[id].supported || value < params[id].min ||
+	    value > params[id].max) {
+		return 0;
+	}
+
+	values[id] = value;
+	loaded |= BIT(id);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(node_config, NODE_CONFIG_SETTINGS_KEY, NULL,
+			       config_settings_set, NULL, NULL);
+#endif
+
+/* Flash writes take a while, keep them out of the CoAP and shell paths */
+static void save_config(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	uint32_t pending = atomic_clear(&dirty);
+	char name[sizeof(NODE_CONFIG_SETTINGS_KEY) + 16];
+	int ret;
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!(pending & BIT(i))) {
+			continue;
+		}
+
+		snprintf(name, sizeof(name), NODE_CONFIG_SETTINGS_KEY "/%s",
+			 params[i].name);
+		ret = settings_save_one(name, &values[i], sizeof(values[i]));
+		if (ret) {
+			LOG_ERR("Cannot store '%s', (error: %d)", params[i].name,
+				ret);
+		}
+	}
+
+	pending = atomic_clear(&gains_dirty);
+
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		if (!(pending & BIT(z))) {
+			continue;
+		}
+
+		ret = heater_gains_save(z);
+		if (ret) {
+			LOG_ERR("Cannot store gains of zone %d, (error: %d)", z,
+				ret);
+		}
+	}
+#endif
+}
+
+void node_config_init(void)
+{
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		values[i] = params[i].def;
+	}
+
+	k_work_init(&save_work, save_config);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	int ret = settings_subsys_init();
+
+	if (!ret) {
+		ret = settings_load_subtree(NODE_CONFIG_SETTINGS_KEY);
+	}
+	if (ret) {
+		LOG_ERR("Cannot load configuration, (error: %d)", ret);
+	}
+#endif
+}
+
+void node_config_set_callback(node_config_changed_cb_t cb)
+{
+	int ret;
+
+	on_change = cb;
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (cb && (loaded & BIT(i))) {
+			ret = cb(i, values[i]);
+			if (ret) {
+				LOG_ERR("Cannot apply stored %s=%d, (error: %d)",
+					params[i].name, values[i], ret);
+			}
+		}
+	}
+}
+
+/* Apply the parameters in changed, or none of them */
+static int apply(uint32_t changed, const int32_t *pending)
+{
+	int32_t previous[NODE_CONFIG_COUNT];
+	int ret;
+
+	memcpy(previous, values, sizeof(previous));
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!(changed & BIT(i))) {
+			continue;
+		}
+
+		values[i] = pending[i];
+		ret = on_change ? on_change(i, values[i]) : 0;
+		if (ret) {
+			LOG_WRN("Cannot apply %s=%d, (error: %d)",
+				params[i].name, values[i], ret);
+
+			for (int j = i; j >= 0; j--) {
+				if (changed & BIT(j)) {
+					values[j] = previous[j];
+					(void)on_change(j, values[j]);
+				}
+			}
+			return -EIO;
+		}
+
+		LOG_INF("Config %s=%d", params[i].name, values[i]);
+	}
+
+	return 0;
+}
+
+int32_t node_config_get(enum node_config_id id)
+{
+	__ASSERT_NO_MSG(id < NODE_CONFIG_COUNT);
+
+	return values[id];
+}
+
+int node_config_set(const char *text)
+{
+	char buf[NODE_CONFIG_TEXT_MAX];
+	int32_t pending[NODE_CONFIG_COUNT];
+	struct pid_gains gains[CONFIG_HEATER_ZONE_COUNT];
+	uint32_t gains_changed = 0;
+	uint32_t changed = 0;
+	char *item, *save;
+	int ret;
+
+	if (strlen(text) >= sizeof(buf)) {
+		return -EINVAL;
+	}
+	strcpy(buf, text);
+
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		heater_gains_get(z, &gains[z]);
+	}
+
+	/* Validate everything before touching anything */
+	for (item = strtok_r(buf, ";", &save); item;
+	     item = strtok_r(NULL, ";", &save)) {
+		char *value = strchr(item, '=');
+		int id;
+
+		if (!value) {
+			return -EINVAL;
+		}
+
+		id = find_param(item, value - item);
+		if (id < 0) {
+			ret = parse_gain(item, value - item, value + 1, gains);
+			if (ret < 0) {
+				return ret;
+			}
+
+			gains_changed |= BIT(ret);
+			continue;
+		}
+
+		if (!params[id].supported) {
+			return -ENOTSUP;
+		}
+
+		ret = parse_value(id, value + 1, &pending[id]);
+		if (ret) {
+			return ret;
+		}
+
+		changed |= BIT(id);
+	}
+
+	/* Nothing is stored unless the node could take it */
+	ret = apply(changed, pending);
+	if (ret) {
+		return ret;
+	}
+
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		if (!(gains_changed & BIT(z))) {
+			continue;
+		}
+
+		LOG_INF("Zone %d gains k_p %f k_i %f k_d %f", z, gains[z].k_p,
+			gains[z].k_i, gains[z].k_d);
+
+		/* The loop picks them up next run, save_work stores them */
+		heater_gains_set(z, &gains[z]);
+	}
+
+	if (changed || gains_changed) {
+		atomic_or(&dirty, changed);
+		atomic_or(&gains_dirty, gains_changed);
+		k_work_submit(&save_work);
+	}
+
+	return 0;
+}
+
+int node_config_format(char *buf, size_t len)
+{
+	struct pid_gains gains;
+	int ret = 0;
+	size_t off;
+
+	buf[0] = '\0';
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!params[i].supported) {
+			continue;
+		}
+
+		off = MIN((size_t)ret, len);
+
+		if (i == NODE_CONFIG_MODE) {
+			ret += snprintf(buf + off, len - off, "%s%s=%s",
+					ret ? ";" : "", params[i].name,
+					mode_names[values[i]]);
+		} else {
+			ret += snprintf(buf + off, len - off, "%s%s=%d",
+					ret ? ";" : "", params[i].name,
+					values[i]);
+		}
+	}
+
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		heater_gains_get(z, &gains);
+
+		for (int g = 0; g < ARRAY_SIZE(gain_names); g++) {
+			off = MIN((size_t)ret, len);
+			ret += snprintf(buf + off, len - off, "%sk%c%d=%g",
+					ret ? ";" : "", gain_names[g], z,
+					(double)*gain_field(&gains, g));
+		}
+	}
+
+	return ret;
+}
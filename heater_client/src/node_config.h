@@ -0,0 +1,80 @@
+/**
+ * @file
+ * @defgroup node_config Runtime configuration persisted to settings
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __NODE_CONFIG_H__
+#define __NODE_CONFIG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum node_config_id {
+	NODE_CONFIG_PERIOD,	/* Setpoint poll and report period [ms] */
+	NODE_CONFIG_POLL,	/* Sleepy data poll period [ms], 0 for the default */
+	NODE_CONFIG_MODE,	/* Link mode, enum coap_client_link_mode */
+	NODE_CONFIG_CSL,	/* CSL period [ms] */
+	NODE_CONFIG_CONTROL,	/* Control loop period [ms] */
+	NODE_CONFIG_OVERTEMP,	/* Over-temperature alarm threshold [C] */
+	NODE_CONFIG_COUNT
+};
+
+/** @brief Type indicates function called when a parameter changes.
+ *
+ * @param[in] id    Changed parameter.
+ * @param[in] value New value, already validated.
+ *
+ * @return 0 if the node runs with the new value, negative error code otherwise.
+ */
+typedef int (*node_config_changed_cb_t)(enum node_config_id id, int32_t value);
+
+/** @brief Load the stored parameters, the others keep their defaults.
+ */
+void node_config_init(void);
+
+/** @brief Set the function applying parameter changes.
+ *
+ * Parameters loaded from settings are passed to it right away, so the
+ * caller only needs to apply what differs from the defaults.
+ */
+void node_config_set_callback(node_config_changed_cb_t cb);
+
+/** @brief Get the value of a parameter.
+ */
+int32_t node_config_get(enum node_config_id id);
+
+/** @brief Validate, apply and persist parameters.
+ *
+ * Nothing is changed unless every assignment is valid. Besides the
+ * parameters above, "kp<zone>", "ki<zone>" and "kd<zone>" set the PID
+ * gains through heater_gains_set(). Storing happens later from a work item.
+ *
+ * @param[in] text "key=value" assignments separated by ';'.
+ *
+ * @retval 0        On success.
+ * @retval -EINVAL  Malformed assignment or value out of range.
+ * @retval -ENOENT  Unknown parameter.
+ * @retval -ENOTSUP Parameter not supported by this build.
+ * @retval -EIO     The node cannot run with the new values, the previous
+ *                  ones are restored and nothing is stored.
+ */
+int node_config_set(const char *text);
+
+/** @brief Print the supported parameters and gains as "key=value;...".
+ *
+ * @return Number of characters that would have been written, see snprintf.
+ */
+int node_config_format(char *buf, size_t len);
+
+#endif
+
+/**
+ * @}
+ */
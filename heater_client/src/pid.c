@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+
+#include "pid.h"
+
+#define D_FILTER_S (CONFIG_HEATER_PID_D_FILTER_MS / 1000.0f)
+
+void pid_init(struct pid_ctrl *pid, const struct pid_gains *gains,
+	      float out_min, float out_max)
+{
+	pid->gains = *gains;
+	pid->integral = 0;
+	pid->previous_error = 0;
+	pid->derivative = 0;
+	pid->out_min = out_min;
+	pid->out_max = out_max;
+}
+
+float pid_update(struct pid_ctrl *pid, float error, float dt)
+{
+	float derivative;
+	float integral;
+	float out;
+
+	/* Integrated in output units, a gain change causes no bump */
+	integral = CLAMP(pid->integral + pid->gains.k_i * error * dt,
+			 pid->out_min, pid->out_max);
+
+	/* A short dt only moves the filtered derivative a little, so one
+	 * quantization step cannot spike the output.
+	 */
+	derivative = (error - pid->previous_error) / dt;
+	pid->previous_error = error;
+	pid->derivative += (derivative - pid->derivative) * dt / (D_FILTER_S + dt);
+
+	out = pid->gains.k_p * error + integral +
+	      pid->gains.k_d * pid->derivative;
+
+	/* Conditional integration, hold the integral while it can't help */
+	if ((out < pid->out_max || error < 0) &&
+	    (out > pid->out_min || error > 0)) {
+		pid->integral = integral;
+	}
+
+	return CLAMP(out, pid->out_min, pid->out_max);
+}
+
+void pid_reset_integral(struct pid_ctrl *pid)
+{
+	pid->integral = 0;
+}
+
+void pid_reset(struct pid_ctrl *pid, float error)
+{
+	pid->integral = 0;
+	pid->previous_error = error;
+	pid->derivative = 0;
+}
+
+void pid_setpoint_changed(struct pid_ctrl *pid, float delta)
+{
+	pid->previous_error += delta;
+}
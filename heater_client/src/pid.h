@@ -0,0 +1,81 @@
+/**
+ * @file
+ * @defgroup pid PID controller API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __PID_H__
+#define __PID_H__
+
+/** @brief Proportional, integral and derivative gains.
+ *
+ *  Time is counted in seconds, so k_i is per second and k_d in seconds.
+ */
+struct pid_gains {
+	float k_p;
+	float k_i;
+	float k_d;
+};
+
+struct pid_ctrl {
+	struct pid_gains gains;
+	float integral;		/* Integral term, within [out_min, out_max] */
+	float previous_error;
+	float derivative;	/* Low-pass filtered derivative of the error */
+	float out_min;
+	float out_max;
+};
+
+/** @brief Initialize a controller and clear its state.
+ *
+ * @param[in] pid     controller to initialize.
+ * @param[in] gains   initial gains.
+ * @param[in] out_min lowest output.
+ * @param[in] out_max highest output.
+ */
+void pid_init(struct pid_ctrl *pid, const struct pid_gains *gains,
+	      float out_min, float out_max);
+
+/** @brief Run one controller iteration.
+ *
+ * The integral term alone may cover the whole output range, so a tuned
+ * loop can hold any steady-state output. It is held while the output
+ * is saturated in the direction the error pushes, so it does not wind up.
+ *
+ * @param[in] pid   controller.
+ * @param[in] error setpoint minus measured value.
+ * @param[in] dt    time since the previous iteration in seconds.
+ *
+ * @return Controller output clamped to [out_min, out_max].
+ */
+float pid_update(struct pid_ctrl *pid, float error, float dt);
+
+/** @brief Clear the integral term, e.g. after a sensor fault.
+ */
+void pid_reset_integral(struct pid_ctrl *pid);
+
+/** @brief Clear the controller state while another source drives the output.
+ *
+ * @param[in] pid   controller.
+ * @param[in] error current error, so that taking over causes no derivative kick.
+ */
+void pid_reset(struct pid_ctrl *pid, float error);
+
+/** @brief Account for a setpoint step so that it causes no derivative kick.
+ *
+ * @param[in] pid   controller.
+ * @param[in] delta new setpoint minus the previous one.
+ */
+void pid_setpoint_changed(struct pid_ctrl *pid, float delta);
+
+#endif
+
+/**
+ * @}
+ */
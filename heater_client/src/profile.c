@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "profile.h"
+#include "setpoint.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define PROFILE_TEXT_MAX 256
+
+struct zone_profile {
+	struct profile_segment segments[CONFIG_HEATER_PROFILE_SEGMENTS];
+	uint32_t count;
+	uint32_t current;
+	bool running;
+	bool holding;
+	bool started;
+	float start_temp;	/* Setpoint the current ramp started from */
+	int64_t start_time;	/* Start of the current ramp or hold [ms] */
+};
+
+static struct zone_profile profiles[CONFIG_HEATER_ZONE_COUNT];
+static struct k_spinlock profile_lock;
+
+static int parse_segment(char *text, uint32_t *zone,
+			 struct profile_segment *segment)
+{
+	char *end;
+	long hold;
+
+	*zone = strtoul(text, &end, 10);
+	if (end == text || *end != ',' || *zone >= CONFIG_HEATER_ZONE_COUNT) {
+		return -EINVAL;
+	}
+
+	text = end + 1;
+	segment->target = strtof(text, &end);
+	if (end == text || *end != ',') {
+		return -EINVAL;
+	}
+
+	text = end + 1;
+	segment->rate = strtof(text, &end);
+	if (end == text || *end != ',' || segment->rate < 0) {
+		return -EINVAL;
+	}
+
+	text = end + 1;
+	hold = strtol(text, &end, 10);
+	if (end == text || *end != '\0' || hold < 0) {
+		return -EINVAL;
+	}
+	segment->hold_s = hold;
+
+	return 0;
+}
+
+int profile_load(const char *text, size_t len, struct profile *parsed)
+{
+	char buf[PROFILE_TEXT_MAX];
+	char *save;
+	char *token;
+	k_spinlock_key_t key;
+
+	if (len >= sizeof(buf)) {
+		return -ENOMEM;
+	}
+
+	memcpy(buf, text, len);
+	buf[len] = '\0';
+	memset(parsed, 0, sizeof(*parsed));
+
+	for (token = strtok_r(buf, ";", &save); token != NULL;
+	     token = strtok_r(NULL, ";", &save)) {
+		struct profile_segment segment;
+		uint32_t zone;
+
+		if (parse_segment(token, &zone, &segment)) {
+			LOG_ERR("Invalid profile segment: %s", token);
+			return -EINVAL;
+		}
+
+		if (parsed->count[zone] == CONFIG_HEATER_PROFILE_SEGMENTS) {
+			LOG_ERR("Too many profile segments for zone %d", zone);
+			return -ENOMEM;
+		}
+
+		parsed->segments[zone][parsed->count[zone]++] = segment;
+	}
+
+	key = k_spin_lock(&profile_lock);
+
+	for (uint32_t zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		memset(&profiles[zone], 0, sizeof(profiles[zone]));
+		memcpy(profiles[zone].segments, parsed->segments[zone],
+		       sizeof(profiles[zone].segments));
+		profiles[zone].count = parsed->count[zone];
+		profiles[zone].running = parsed->count[zone] > 0;
+	}
+
+	k_spin_unlock(&profile_lock, key);
+
+	LOG_INF("Profile loaded");
+	setpoint_notify();
+
+	return 0;
+}
+
+void profile_stop(void)
+{
+	profile_stop_zones(BIT_MASK(CONFIG_HEATER_ZONE_COUNT));
+}
+
+void profile_stop_zones(uint32_t zones)
+{
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+	for (uint32_t zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		if (zones & BIT(zone)) {
+			memset(&profiles[zone], 0, sizeof(profiles[zone]));
+		}
+	}
+
+	k_spin_unlock(&profile_lock, key);
+
+	setpoint_notify();
+}
+
+/* Advance the profile to @p now and return its setpoint */
+static float profile_step(struct zone_profile *p, int64_t now)
+{
+	const struct profile_segment *segment;
+	float setpoint;
+	float ramped;
+
+	while (true) {
+		segment = &p->segments[p->current];
+
+		if (p->holding) {
+			if (now - p->start_time < segment->hold_s * MSEC_PER_SEC) {
+				return segment->target;
+			}
+
+			/* Hold finished, next ramp starts from this target */
+			p->start_temp = segment->target;
+			p->start_time += segment->hold_s * MSEC_PER_SEC;
+			p->holding = false;
+
+			if (++p->current == p->count) {
+				p->running = false;
+				LOG_INF("Profile finished");
+				return segment->target;
+			}
+
+			continue;
+		}
+
+		if (segment->rate == 0) {
+			setpoint = segment->target;
+		} else {
+			ramped = segment->rate * (now - p->start_time) /
+				 (60.0f * MSEC_PER_SEC);
+			setpoint = (segment->target > p->start_temp) ?
+				   MIN(p->start_temp + ramped, segment->target) :
+				   MAX(p->start_temp - ramped, segment->target);
+		}
+
+		if (setpoint != segment->target) {
+			return setpoint;
+		}
+
+		/* Ramp finished, the soak starts now */
+		if (segment->rate == 0) {
+			p->start_time = now;
+		} else {
+			p->start_time += fabsf(segment->target - p->start_temp) /
+					 segment->rate * 60.0f * MSEC_PER_SEC;
+		}
+		p->holding = true;
+	}
+}
+
+float profile_get_target(uint32_t zone, int64_t now, float measured,
+			 float fallback)
+{
+	struct zone_profile *p = &profiles[zone];
+	float setpoint = fallback;
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+
+	if (p->running) {
+		/* The first ramp starts from where the zone is right now */
+		if (!p->started) {
+			p->start_temp = measured;
+			p->start_time = now;
+			p->started = true;
+		}
+
+		setpoint = profile_step(p, now);
+	} else if (p->started) {
+		/* A finished profile keeps its last target until replaced */
+		setpoint = p->segments[p->count - 1].target;
+	}
+
+	k_spin_unlock(&profile_lock, key);
+
+	return setpoint;
+}
+
+bool profile_get_progress(uint32_t zone, uint32_t *segment, uint32_t *count)
+{
+	k_spinlock_key_t key = k_spin_lock(&profile_lock);
+	bool running = profiles[zone].running;
+
+	*segment = profiles[zone].current;
+	*count = profiles[zone].count;
+	k_spin_unlock(&profile_lock, key);
+
+	return running;
+}
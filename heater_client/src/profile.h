@@ -0,0 +1,97 @@
+/**
+ * @file
+ * @defgroup profile Setpoint ramp/soak profiles
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __PROFILE_H__
+#define __PROFILE_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief One step of a profile.
+ *
+ * The setpoint moves from where the previous segment ended towards
+ * @p target at @p rate and then holds it for @p hold_s seconds. The hold
+ * time only starts once the ramp has reached the target.
+ */
+struct profile_segment {
+	float target;		/* degC */
+	float rate;		/* degC per minute, 0 steps immediately */
+	uint32_t hold_s;
+};
+
+struct profile;
+
+#if defined(CONFIG_HEATER_PROFILE)
+/** @brief Segments of every zone, parsed by profile_load().
+ */
+struct profile {
+	struct profile_segment segments[CONFIG_HEATER_ZONE_COUNT]
+				       [CONFIG_HEATER_PROFILE_SEGMENTS];
+	uint32_t count[CONFIG_HEATER_ZONE_COUNT];
+};
+#endif
+
+/** @brief Load a profile from its text form and start running it.
+ *
+ * The text is a semicolon separated list of
+ * "<zone>,<target>,<rate>,<hold>" segments, run in order per zone, e.g.
+ * "0,60,2,600;0,35,0,0". Zones not mentioned keep following the server.
+ *
+ * @param[in]  text    Profile text, not NUL terminated.
+ * @param[in]  len     Length of @p text.
+ * @param[out] parsed  Scratch space for the parser, owned by the caller.
+ *
+ * @retval 0       On success.
+ * @retval -EINVAL Malformed text, the running profile is kept.
+ * @retval -ENOMEM Too many segments for a zone.
+ */
+int profile_load(const char *text, size_t len, struct profile *parsed);
+
+/** @brief Drop the profile of every zone, the server target applies again.
+ *
+ * A finished profile keeps its last target until this is called.
+ */
+void profile_stop(void);
+
+/** @brief Drop the profile of some zones only.
+ *
+ * @param[in] zones Bit mask of the zones, the others keep their profile.
+ */
+void profile_stop_zones(uint32_t zones);
+
+/** @brief Get the setpoint of a zone for this control loop iteration.
+ *
+ * @param[in] zone     Zone index.
+ * @param[in] now      Current uptime [ms].
+ * @param[in] measured Current temperature, where the first ramp starts from.
+ * @param[in] fallback Setpoint to use when the zone has no running profile.
+ *
+ * @return The setpoint in degC.
+ */
+float profile_get_target(uint32_t zone, int64_t now, float measured,
+			 float fallback);
+
+/** @brief Get the progress of a zone.
+ *
+ * @param[in]  zone    Zone index.
+ * @param[out] segment Index of the running segment.
+ * @param[out] count   Number of segments loaded for the zone.
+ *
+ * @return true if the zone is running its profile.
+ */
+bool profile_get_progress(uint32_t zone, uint32_t *segment, uint32_t *count);
+
+#endif
+
+/**
+ * @}
+ */
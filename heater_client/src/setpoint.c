@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+
+#include <stdlib.h>
+
+#include "pipeline_trace.h"
+#include "setpoint.h"
+
+#define SETPOINT_CHANGED BIT(0)
+
+/* The sequence is odd while a write is in progress */
+static atomic_t sequence;
+static volatile float values[CONFIG_HEATER_ZONE_COUNT] = {
+	[0 ... CONFIG_HEATER_ZONE_COUNT - 1] = 40.0f
+};
+static struct k_spinlock writer_lock;
+
+static K_EVENT_DEFINE(setpoint_event);
+
+uint32_t setpoint_publish(const float *targets, size_t count)
+{
+	k_spinlock_key_t key;
+	uint32_t changed = 0;
+	size_t zone;
+
+	if (count == 0) {
+		return 0;
+	}
+
+	key = k_spin_lock(&writer_lock);
+
+	/* Polling returns the same targets most of the time, don't wake on those */
+	for (zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		if (values[zone] != targets[MIN(zone, count - 1)]) {
+			changed |= BIT(zone);
+		}
+	}
+
+	if (!changed) {
+		k_spin_unlock(&writer_lock, key);
+		return 0;
+	}
+
+	atomic_inc(&sequence);
+	compiler_barrier();
+	for (zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+		values[zone] = targets[MIN(zone, count - 1)];
+	}
+	compiler_barrier();
+	atomic_inc(&sequence);
+
+	k_spin_unlock(&writer_lock, key);
+
+	setpoint_notify();
+
+	return changed;
+}
+
+int setpoint_parse(const char *text, float *targets)
+{
+	const char *pos = text;
+	char *end;
+	int count = 0;
+
+	while (count < CONFIG_HEATER_ZONE_COUNT) {
+		targets[count] = strtof(pos, &end);
+		if (end == pos) {
+			break;
+		}
+
+		count++;
+		if (*end != ';') {
+			break;
+		}
+		pos = end + 1;
+	}
+
+	return count ? count : -EINVAL;
+}
+
+void setpoint_notify(void)
+{
+	PIPELINE_TRACE(TRACE_SETPOINT, atomic_get(&sequence) / 2, 0);
+	k_event_post(&setpoint_event, SETPOINT_CHANGED);
+}
+
+void setpoint_read(float *targets, uint32_t *version)
+{
+	atomic_val_t seq;
+
+	do {
+		seq = atomic_get(&sequence);
+		compiler_barrier();
+		for (int zone = 0; zone < CONFIG_HEATER_ZONE_COUNT; zone++) {
+			targets[zone] = values[zone];
+		}
+		compiler_barrier();
+	} while ((seq & 1) || seq != atomic_get(&sequence));
+
+	if (version) {
+		*version = seq / 2;
+	}
+}
+
+bool setpoint_wait(k_timeout_t timeout)
+{
+	if (!k_event_wait(&setpoint_event, SETPOINT_CHANGED, false, timeout)) {
+		return false;
+	}
+
+	/* Clear before the setpoint is read so no change can be missed */
+	k_event_set(&setpoint_event, 0);
+
+	return true;
+}
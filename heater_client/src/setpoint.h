@@ -0,0 +1,68 @@
+/**
+ * @file
+ * @defgroup setpoint Setpoint publication to the control loop
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __SETPOINT_H__
+#define __SETPOINT_H__
+
+#include <zephyr/kernel.h>
+
+/** @brief Publish new server setpoints and wake the control loop.
+ *
+ * All zones are updated together, a reader never sees a mix of old and
+ * new targets. Publishing the current targets again does nothing.
+ *
+ * @param[in] targets New targets in degC, one per zone.
+ * @param[in] count   Number of targets. Zones past the last one given
+ *                    take the last target, so one value drives all zones.
+ *
+ * @return Bit mask of the zones whose target changed.
+ */
+uint32_t setpoint_publish(const float *targets, size_t count);
+
+/** @brief Parse setpoints in their text form, "<target>[;<target>...]".
+ *
+ * @param[in]  text    NUL terminated text.
+ * @param[out] targets Parsed targets, room for one per zone.
+ *
+ * @return Number of targets parsed, to be passed to setpoint_publish(),
+ *         or -EINVAL if there is none.
+ */
+int setpoint_parse(const char *text, float *targets);
+
+/** @brief Wake the control loop without changing the server setpoint.
+ *
+ * Used when another setpoint source, such as a profile, changes.
+ */
+void setpoint_notify(void);
+
+/** @brief Read the last published setpoints of all zones.
+ *
+ * All zones are read under one sequence check, so they come from the
+ * same publication regardless of the writer being preempted.
+ *
+ * @param[out] targets Setpoints in degC, one per zone.
+ * @param[out] version Incremented on every publication, may be NULL.
+ */
+void setpoint_read(float *targets, uint32_t *version);
+
+/** @brief Sleep until the setpoint changes or the timeout expires.
+ *
+ * @retval true  Woken by a setpoint change.
+ * @retval false Timeout.
+ */
+bool setpoint_wait(k_timeout_t timeout);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/printk.h>
+
+#include <math.h>
+#include <stdlib.h>
+
+#include <nsi_main.h>
+
+#include "thermal_plant.h"
+#include "control_bench.h"
+#include "../coap_client.h"
+#include "../setpoint.h"
+
+/* Takes the place of the CoAP client utilities on the simulator */
+LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
+
+#define BENCH_MAX_STEPS 16
+#define BENCH_STACK_SIZE 2048
+#define BENCH_PRIORITY 3
+
+/* Steady-state error is averaged over the last fifth of every step */
+#define STEADY_STATE_WINDOW_DIV 5
+
+#define SETTLE_BAND (CONFIG_HEATER_SIM_SETTLE_BAND_MC / 1000.0f)
+
+struct bench_step {
+	uint32_t start_ms;
+	float target;
+};
+
+struct zone_metrics {
+	float direction;	/* +1 for a rising step, -1 for a falling one */
+	float overshoot;	/* Largest excursion past the target in degC */
+	int64_t settled_at;	/* Step time of the last out-of-band sample */
+	double error_sum;
+	uint32_t error_count;
+};
+
+struct loop_stats {
+	int64_t last_ms;
+	uint32_t count;
+	double mean;
+	double m2;
+	int64_t min;
+	int64_t max;
+	int64_t published_ms;	/* When the pending setpoint change was made */
+	int64_t latency_max;	/* Worst delay until the loop picked it up */
+	uint32_t version;	/* Setpoint version the loop last read */
+};
+
+static struct bench_step steps[BENCH_MAX_STEPS];
+static int step_count;
+static struct zone_metrics metrics[THERMAL_PLANT_ZONES];
+static struct loop_stats loop;
+
+static K_SEM_DEFINE(bench_start, 0, 1);
+
+static int parse_script(const char *script)
+{
+	const char *pos = script;
+	char *end;
+
+	while (*pos && step_count < BENCH_MAX_STEPS) {
+		long start_s = strtol(pos, &end, 10);
+
+		if (end == pos || *end != ':') {
+			return -EINVAL;
+		}
+
+		pos = end + 1;
+		steps[step_count].start_ms = start_s * MSEC_PER_SEC;
+		steps[step_count].target = strtof(pos, &end);
+		if (end == pos) {
+			return -EINVAL;
+		}
+
+		step_count++;
+		pos = (*end == ';') ? end + 1 : end;
+	}
+
+	return step_count ? 0 : -EINVAL;
+}
+
+void control_bench_on_actuation(uint32_t channel)
+{
+	int64_t now = k_uptime_get();
+	int64_t period;
+	double delta;
+
+	/* All channels are written back to back, the first one paces the loop */
+	if (channel != 0) {
+		return;
+	}
+
+	if (loop.last_ms) {
+		period = now - loop.last_ms;
+
+		if (!loop.count || period < loop.min) {
+			loop.min = period;
+		}
+		if (!loop.count || period > loop.max) {
+			loop.max = period;
+		}
+
+		loop.count++;
+		delta = period - loop.mean;
+		loop.mean += delta / loop.count;
+		loop.m2 += delta * (period - loop.mean);
+	}
+
+	loop.last_ms = now;
+}
+
+static void step_begin(int step)
+{
+	for (int zone = 0; zone < THERMAL_PLANT_ZONES; zone++) {
+		float temperature = thermal_plant_get_temp(zone);
+
+		metrics[zone] = (struct zone_metrics){
+			.direction = (steps[step].target >= temperature) ? 1 : -1,
+		};
+	}
+
+	loop.published_ms = k_uptime_get();
+	setpoint_publish(&steps[step].target, 1);
+	printk("BENCH step %d target %.2f at %u ms\n", step, steps[step].target,
+	       steps[step].start_ms);
+}
+
+static void step_sample(int step, uint32_t elapsed_ms, uint32_t length_ms)
+{
+	uint32_t step_ms = elapsed_ms - steps[step].start_ms;
+
+	for (int zone = 0; zone < THERMAL_PLANT_ZONES; zone++) {
+		struct zone_metrics *m = &metrics[zone];
+		float error = thermal_plant_get_temp(zone) - steps[step].target;
+
+		m->overshoot = MAX(m->overshoot, m->direction * error);
+
+		if (fabsf(error) > SETTLE_BAND) {
+			m->settled_at = step_ms;
+		}
+
+		if (step_ms >= length_ms - length_ms / STEADY_STATE_WINDOW_DIV) {
+			m->error_sum += error;
+			m->error_count++;
+		}
+	}
+}
+
+static void step_end(int step, uint32_t length_ms)
+{
+	for (int zone = 0; zone < THERMAL_PLANT_ZONES; zone++) {
+		struct zone_metrics *m = &metrics[zone];
+		bool settled = m->settled_at < length_ms - length_ms / STEADY_STATE_WINDOW_DIV;
+
+		printk("BENCH step %d zone %d settle_ms %lld overshoot %.2f sse %.3f\n",
+		       step, zone, settled ? (long long)m->settled_at : -1LL, m->overshoot,
+		       m->error_count ? m->error_sum / m->error_count : 0.0);
+	}
+}
+
+static void report_loop(void)
+{
+	k_thread_runtime_stats_t stats;
+	double std = (loop.count > 1) ? sqrt(loop.m2 / (loop.count - 1)) : 0;
+
+	printk("BENCH loop n %u period_ms mean %.1f std %.2f min %lld max %lld\n",
+	       loop.count, loop.mean, std, (long long)loop.min,
+	       (long long)loop.max);
+
+	printk("BENCH setpoint_pickup_ms max %lld\n",
+	       (long long)loop.latency_max);
+
+	if (!k_thread_runtime_stats_all_get(&stats) && stats.execution_cycles) {
+		printk("BENCH cpu_load %.2f%%\n",
+		       100.0 * (stats.execution_cycles - stats.idle_cycles) /
+		       stats.execution_cycles);
+	}
+}
+
+static void control_bench_thread(void)
+{
+	const uint32_t duration_ms = CONFIG_HEATER_SIM_DURATION_S * MSEC_PER_SEC;
+	int64_t start;
+	uint32_t elapsed;
+	int step = 0;
+
+	k_sem_take(&bench_start, K_FOREVER);
+	start = k_uptime_get();
+	step_begin(step);
+
+	do {
+		k_msleep(CONFIG_HEATER_SIM_STEP_MS);
+		elapsed = k_uptime_get() - start;
+
+		uint32_t step_end_ms = (step + 1 < step_count) ?
+				       steps[step + 1].start_ms : duration_ms;
+		uint32_t length_ms = step_end_ms - steps[step].start_ms;
+
+		step_sample(step, elapsed, length_ms);
+
+		if (elapsed >= step_end_ms) {
+			step_end(step, length_ms);
+			if (++step < step_count) {
+				step_begin(step);
+			}
+		}
+	} while (elapsed < duration_ms);
+
+	report_loop();
+	printk("BENCH done\n");
+
+	nsi_exit(0);
+}
+
+K_THREAD_DEFINE(control_bench, BENCH_STACK_SIZE, control_bench_thread,
+		NULL, NULL, NULL, BENCH_PRIORITY, K_FP_REGS, 0);
+
+void coap_client_init(void)
+{
+	if (parse_script(CONFIG_HEATER_SIM_SETPOINT_SCRIPT)) {
+		LOG_ERR("Invalid setpoint script: %s",
+			CONFIG_HEATER_SIM_SETPOINT_SCRIPT);
+		nsi_exit(1);
+	}
+
+	if (steps[0].start_ms != 0) {
+		LOG_WRN("Setpoint script does not start at 0 s");
+	}
+
+	setpoint_publish(&steps[0].target, 1);
+	k_sem_give(&bench_start);
+}
+
+void retrieve_stored_target_temps(float *targets)
+{
+	uint32_t version;
+
+	setpoint_read(targets, &version);
+
+	if (version != loop.version && loop.published_ms) {
+		loop.latency_max = MAX(loop.latency_max,
+				       k_uptime_get() - loop.published_ms);
+	}
+	loop.version = version;
+}
+
+void report_zone_state(uint32_t zone, float measured, float duty)
+{
+	/* Nobody to report to, the benchmark samples the plant directly */
+	ARG_UNUSED(zone);
+	ARG_UNUSED(measured);
+	ARG_UNUSED(duty);
+}
@@ -0,0 +1,28 @@
+/**
+ * @file
+ * @defgroup control_bench Control-performance benchmark API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __CONTROL_BENCH_H__
+#define __CONTROL_BENCH_H__
+
+#include <stdint.h>
+
+/** @brief Record a heater output update for the loop jitter statistics.
+ *
+ * @param[in] channel PWM channel the control loop has just written.
+ */
+void control_bench_on_actuation(uint32_t channel);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#define DT_DRV_COMPAT gdp_max6675_sim
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/sensor.h>
+
+#include "thermal_plant.h"
+
+/* The MAX6675 reports the thermocouple temperature in 0.25 degC steps */
+#define MAX6675_LSB_PER_DEGC 4
+
+struct max6675_sim_config {
+	uint32_t zone;
+};
+
+struct max6675_sim_data {
+	int32_t sample;		/* Last conversion in 0.25 degC steps */
+};
+
+static int max6675_sim_sample_fetch(const struct device *dev,
+				    enum sensor_channel chan)
+{
+	const struct max6675_sim_config *config = dev->config;
+	struct max6675_sim_data *data = dev->data;
+
+	if (chan != SENSOR_CHAN_ALL && chan != SENSOR_CHAN_AMBIENT_TEMP) {
+		return -ENOTSUP;
+	}
+
+	data->sample = (int32_t)(thermal_plant_get_temp(config->zone) *
+				 MAX6675_LSB_PER_DEGC);
+
+	return 0;
+}
+
+static int max6675_sim_channel_get(const struct device *dev,
+				   enum sensor_channel chan,
+				   struct sensor_value *val)
+{
+	struct max6675_sim_data *data = dev->data;
+
+	if (chan != SENSOR_CHAN_AMBIENT_TEMP) {
+		return -ENOTSUP;
+	}
+
+	val->val1 = data->sample / MAX6675_LSB_PER_DEGC;
+	val->val2 = (data->sample % MAX6675_LSB_PER_DEGC) *
+		    (1000000 / MAX6675_LSB_PER_DEGC);
+
+	return 0;
+}
+
+static const struct sensor_driver_api max6675_sim_api = {
+	.sample_fetch = max6675_sim_sample_fetch,
+	.channel_get = max6675_sim_channel_get,
+};
+
+#define MAX6675_SIM_DEFINE(inst)						\
+	static struct max6675_sim_data max6675_sim_data_##inst;			\
+										\
+	static const struct max6675_sim_config max6675_sim_config_##inst = {	\
+		.zone = DT_INST_PROP(inst, zone),				\
+	};									\
+										\
+	DEVICE_DT_INST_DEFINE(inst, NULL, NULL, &max6675_sim_data_##inst,	\
+			      &max6675_sim_config_##inst, POST_KERNEL,		\
+			      CONFIG_SENSOR_INIT_PRIORITY, &max6675_sim_api);
+
+DT_INST_FOREACH_STATUS_OKAY(MAX6675_SIM_DEFINE)
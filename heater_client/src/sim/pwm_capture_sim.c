@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#define DT_DRV_COMPAT gdp_pwm_capture_sim
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/pwm.h>
+
+#include "thermal_plant.h"
+#include "control_bench.h"
+
+static int pwm_capture_sim_set_cycles(const struct device *dev,
+				      uint32_t channel, uint32_t period_cycles,
+				      uint32_t pulse_cycles, pwm_flags_t flags)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(flags);
+
+	if (channel >= THERMAL_PLANT_ZONES || period_cycles == 0) {
+		return -EINVAL;
+	}
+
+	/* The polarity only compensates for the inverting heater driver, the
+	 * pulse width always is the heating share of the period.
+	 */
+	thermal_plant_set_duty(channel, 100.0f * pulse_cycles / period_cycles);
+	control_bench_on_actuation(channel);
+
+	return 0;
+}
+
+static int pwm_capture_sim_get_cycles_per_sec(const struct device *dev,
+					      uint32_t channel,
+					      uint64_t *cycles)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(channel);
+
+	/* One cycle per nanosecond keeps pwm_set() periods exact */
+	*cycles = NSEC_PER_SEC;
+
+	return 0;
+}
+
+static const struct pwm_driver_api pwm_capture_sim_api = {
+	.set_cycles = pwm_capture_sim_set_cycles,
+	.get_cycles_per_sec = pwm_capture_sim_get_cycles_per_sec,
+};
+
+#define PWM_CAPTURE_SIM_DEFINE(inst)						\
+	DEVICE_DT_INST_DEFINE(inst, NULL, NULL, NULL, NULL, POST_KERNEL,	\
+			      CONFIG_PWM_INIT_PRIORITY, &pwm_capture_sim_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PWM_CAPTURE_SIM_DEFINE)
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "thermal_plant.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define STEP_S (CONFIG_HEATER_SIM_STEP_MS / 1000.0f)
+
+#define PLANT_STACK_SIZE 1024
+#define PLANT_PRIORITY 2
+
+struct plant_zone {
+	float temperature;	/* Current zone temperature in degC */
+	float gain;		/* Rise above ambient at 100 % duty in degC */
+	float tau;		/* Time constant in s */
+	uint32_t delay;		/* Dead time in integration steps */
+	float inputs[CONFIG_HEATER_SIM_DELAY_SLOTS]; /* Delayed duty, 0..1 */
+};
+
+static const uint32_t gain_mc[] = DT_PROP(THERMAL_PLANT_NODE, gain_millicelsius);
+static const uint32_t tau_ms[] = DT_PROP(THERMAL_PLANT_NODE, time_constant_ms);
+static const uint32_t dead_time_ms[] = DT_PROP(THERMAL_PLANT_NODE, dead_time_ms);
+
+BUILD_ASSERT(ARRAY_SIZE(tau_ms) == THERMAL_PLANT_ZONES &&
+	     ARRAY_SIZE(dead_time_ms) == THERMAL_PLANT_ZONES,
+	     "Every plant property needs one entry per zone");
+
+static const float ambient =
+	DT_PROP(THERMAL_PLANT_NODE, ambient_millicelsius) / 1000.0f;
+static const float coupling =
+	DT_PROP(THERMAL_PLANT_NODE, coupling_permille) / 1000.0f;
+
+static struct plant_zone zones[THERMAL_PLANT_ZONES];
+static uint32_t head;	/* Delay line slot of the current step */
+static K_MUTEX_DEFINE(plant_mutex);
+
+void thermal_plant_set_duty(uint32_t zone, float duty)
+{
+	if (zone >= THERMAL_PLANT_ZONES) {
+		return;
+	}
+
+	k_mutex_lock(&plant_mutex, K_FOREVER);
+	/* The newest slot is read back once the dead time has elapsed */
+	zones[zone].inputs[head] = CLAMP(duty, 0.0f, 100.0f) / 100.0f;
+	k_mutex_unlock(&plant_mutex);
+}
+
+float thermal_plant_get_temp(uint32_t zone)
+{
+	float temperature;
+
+	if (zone >= THERMAL_PLANT_ZONES) {
+		return ambient;
+	}
+
+	k_mutex_lock(&plant_mutex, K_FOREVER);
+	temperature = zones[zone].temperature;
+	k_mutex_unlock(&plant_mutex);
+
+	return temperature;
+}
+
+static void plant_step(void)
+{
+	float derivative[THERMAL_PLANT_ZONES];
+	uint32_t next = (head + 1) % CONFIG_HEATER_SIM_DELAY_SLOTS;
+
+	for (int i = 0; i < THERMAL_PLANT_ZONES; i++) {
+		struct plant_zone *zone = &zones[i];
+		uint32_t slot = (head + CONFIG_HEATER_SIM_DELAY_SLOTS - zone->delay) %
+				CONFIG_HEATER_SIM_DELAY_SLOTS;
+		float exchange = 0;
+
+		for (int j = 0; j < THERMAL_PLANT_ZONES; j++) {
+			if (j != i) {
+				exchange += coupling *
+					    (zones[j].temperature - zone->temperature);
+			}
+		}
+
+		derivative[i] = (ambient - zone->temperature +
+				 zone->gain * zone->inputs[slot] + exchange) /
+				zone->tau;
+	}
+
+	for (int i = 0; i < THERMAL_PLANT_ZONES; i++) {
+		zones[i].temperature += derivative[i] * STEP_S;
+	}
+
+	/* Hold the last duty until the controller writes a new one */
+	for (int i = 0; i < THERMAL_PLANT_ZONES; i++) {
+		zones[i].inputs[next] = zones[i].inputs[head];
+	}
+	head = next;
+}
+
+static int thermal_plant_init(void)
+{
+	for (int i = 0; i < THERMAL_PLANT_ZONES; i++) {
+		zones[i].temperature = ambient;
+		zones[i].gain = gain_mc[i] / 1000.0f;
+		zones[i].tau = tau_ms[i] / 1000.0f;
+		zones[i].delay = dead_time_ms[i] / CONFIG_HEATER_SIM_STEP_MS;
+
+		if (zones[i].delay >= CONFIG_HEATER_SIM_DELAY_SLOTS) {
+			LOG_WRN("Zone %d dead time clipped to %d steps", i,
+				CONFIG_HEATER_SIM_DELAY_SLOTS - 1);
+			zones[i].delay = CONFIG_HEATER_SIM_DELAY_SLOTS - 1;
+		}
+	}
+
+	return 0;
+}
+
+static void thermal_plant_thread(void)
+{
+	while (1) {
+		k_mutex_lock(&plant_mutex, K_FOREVER);
+		plant_step();
+		k_mutex_unlock(&plant_mutex);
+
+		k_msleep(CONFIG_HEATER_SIM_STEP_MS);
+	}
+}
+
+SYS_INIT(thermal_plant_init, POST_KERNEL, 0);
+
+K_THREAD_DEFINE(thermal_plant, PLANT_STACK_SIZE, thermal_plant_thread,
+		NULL, NULL, NULL, PLANT_PRIORITY, K_FP_REGS, 0);
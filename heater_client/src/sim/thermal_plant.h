@@ -0,0 +1,36 @@
+/**
+ * @file
+ * @defgroup thermal_plant Simulated heater plant API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __THERMAL_PLANT_H__
+#define __THERMAL_PLANT_H__
+
+#include <zephyr/devicetree.h>
+
+#define THERMAL_PLANT_NODE DT_INST(0, gdp_thermal_plant_sim)
+#define THERMAL_PLANT_ZONES DT_PROP_LEN(THERMAL_PLANT_NODE, gain_millicelsius)
+
+/** @brief Set the heater duty of a zone.
+ *
+ * @param[in] zone zone index, equal to the PWM channel.
+ * @param[in] duty duty cycle in %.
+ */
+void thermal_plant_set_duty(uint32_t zone, float duty);
+
+/** @brief Get the current temperature of a zone in degC.
+ */
+float thermal_plant_get_temp(uint32_t zone);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+
+#include "telemetry.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define TELEMETRY_SYNC 0xA5
+
+/* Ring length in records, a power of two so the indexes may wrap freely */
+#define RING_SIZE CONFIG_HEATER_TELEMETRY_RING_SIZE
+#define RING_MASK (RING_SIZE - 1)
+
+BUILD_ASSERT((RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+
+struct telemetry_sample {
+	uint32_t timestamp_ms;
+	uint8_t zone;
+	uint8_t flags;
+	int16_t measured;	/* centi-degC */
+	int16_t target;		/* centi-degC */
+	uint16_t duty;		/* centi-% */
+};
+
+/* Wire format, all fields little endian:
+ * sync | seq | timestamp_ms(4) | zone | flags | measured(2) | target(2) |
+ * duty(2) | crc8 over seq..duty
+ */
+#define FRAME_SIZE 15
+
+static const struct device *uart = DEVICE_DT_GET(DT_CHOSEN(gdp_telemetry_uart));
+
+/* Single producer (control loop), single consumer (UART ISR) */
+static struct telemetry_sample ring[RING_SIZE];
+static atomic_t head;
+static atomic_t tail;
+
+static atomic_t sent;
+static atomic_t dropped;
+static uint32_t decimation_count;
+
+static uint8_t frame[FRAME_SIZE];
+static size_t frame_len;
+static size_t frame_pos;
+static uint8_t frame_seq;
+
+static void frame_encode(const struct telemetry_sample *sample)
+{
+	frame[0] = TELEMETRY_SYNC;
+	frame[1] = frame_seq++;
+	sys_put_le32(sample->timestamp_ms, &frame[2]);
+	frame[6] = sample->zone;
+	frame[7] = sample->flags;
+	sys_put_le16(sample->measured, &frame[8]);
+	sys_put_le16(sample->target, &frame[10]);
+	sys_put_le16(sample->duty, &frame[12]);
+	frame[14] = crc8_ccitt(0, &frame[1], FRAME_SIZE - 2);
+
+	frame_len = FRAME_SIZE;
+	frame_pos = 0;
+}
+
+static bool frame_next(void)
+{
+	atomic_val_t t = atomic_get(&tail);
+
+	if (t == atomic_get(&head)) {
+		return false;
+	}
+
+	frame_encode(&ring[t & RING_MASK]);
+	atomic_set(&tail, t + 1);
+	atomic_inc(&sent);
+
+	return true;
+}
+
+static void telemetry_uart_isr(const struct device *dev, void *user_data)
+{
+	ARG_UNUSED(user_data);
+
+	while (uart_irq_update(dev) && uart_irq_tx_ready(dev)) {
+		if (frame_pos == frame_len && !frame_next()) {
+			uart_irq_tx_disable(dev);
+			return;
+		}
+
+		int len = uart_fifo_fill(dev, &frame[frame_pos],
+					 frame_len - frame_pos);
+
+		if (len <= 0) {
+			return;
+		}
+
+		frame_pos += len;
+	}
+}
+
+int telemetry_init(void)
+{
+	if (!device_is_ready(uart)) {
+		LOG_ERR("Telemetry UART not ready");
+		return -ENODEV;
+	}
+
+	uart_irq_callback_set(uart, telemetry_uart_isr);
+
+	return 0;
+}
+
+void telemetry_record(uint8_t zone, int64_t now_ms, float measured,
+		      float target, float duty, uint8_t flags)
+{
+	atomic_val_t h = atomic_get(&head);
+	struct telemetry_sample *sample;
+
+	/* Decimation counts loop iterations, which start with zone 0 */
+	if (zone == 0) {
+		decimation_count++;
+	}
+	if ((decimation_count - 1) % CONFIG_HEATER_TELEMETRY_DECIMATION) {
+		return;
+	}
+
+	if (h - atomic_get(&tail) >= RING_SIZE) {
+		atomic_inc(&dropped);
+		return;
+	}
+
+	sample = &ring[h & RING_MASK];
+	sample->timestamp_ms = (uint32_t)now_ms;
+	sample->zone = zone;
+	sample->flags = flags;
+	sample->measured = (int16_t)(measured * 100);
+	sample->target = (int16_t)(target * 100);
+	sample->duty = (uint16_t)(duty * 100);
+
+	/* Publish the sample before the ISR can see the new head */
+	atomic_set(&head, h + 1);
+	uart_irq_tx_enable(uart);
+}
+
+void telemetry_get_stats(uint32_t *sent_count, uint32_t *dropped_count)
+{
+	*sent_count = atomic_get(&sent);
+	*dropped_count = atomic_get(&dropped);
+}
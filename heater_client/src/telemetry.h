@@ -0,0 +1,54 @@
+/**
+ * @file
+ * @defgroup telemetry Binary control loop telemetry API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+/** Record flag: the zone is driven by the auto-tuning relay */
+#define TELEMETRY_FLAG_AUTOTUNE BIT(0)
+
+/** @brief Initialize the telemetry UART.
+ *
+ * @retval 0       On success.
+ * @retval -ENODEV The telemetry UART is not ready.
+ */
+int telemetry_init(void);
+
+/** @brief Queue one control loop sample of a zone.
+ *
+ * Never blocks and does no formatting. Samples are decimated by
+ * CONFIG_HEATER_TELEMETRY_DECIMATION and dropped when the ring is full.
+ *
+ * @note Called from the control loop only.
+ *
+ * @param[in] zone        zone index.
+ * @param[in] now_ms      uptime in ms.
+ * @param[in] measured    measured temperature in degC.
+ * @param[in] target      target temperature in degC.
+ * @param[in] duty        heater duty in %.
+ * @param[in] flags       TELEMETRY_FLAG_* bits.
+ */
+void telemetry_record(uint8_t zone, int64_t now_ms, float measured,
+		      float target, float duty, uint8_t flags);
+
+/** @brief Get the number of records sent and dropped since boot.
+ */
+void telemetry_get_stats(uint32_t *sent, uint32_t *dropped);
+
+#endif
+
+/**
+ * @}
+ */
@@ -0,0 +1,266 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+
+#include "trace_recorder.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 10
+#define CHUNK_LEN_SIZE 2
+
+#define VARINT_MAX_SIZE 5
+#define SAMPLE_MAX_SIZE (VARINT_MAX_SIZE * (1 + 3 * CONFIG_HEATER_ZONE_COUNT))
+
+#define OVERSHOOT (CONFIG_HEATER_TRACE_OVERSHOOT_MC / 1000.0f)
+
+BUILD_ASSERT(CONFIG_HEATER_TRACE_CHUNK_SIZE >= SAMPLE_MAX_SIZE,
+	     "A trace chunk must hold at least one sample");
+
+/* Every chunk restarts the delta encoding from zero, so that the oldest
+ * chunk can be dropped without breaking the ones that follow.
+ */
+struct trace_chunk {
+	uint16_t len;
+	uint8_t data[CONFIG_HEATER_TRACE_CHUNK_SIZE];
+};
+
+struct trace_encoder {
+	uint32_t timestamp;
+	int32_t values[CONFIG_HEATER_ZONE_COUNT][3];
+};
+
+static struct trace_chunk chunks[CONFIG_HEATER_TRACE_CHUNKS];
+static uint32_t current;
+static struct trace_encoder encoder;
+
+static enum trace_state state;
+static enum trace_trigger trigger_reason;
+static uint32_t trigger_time;
+static uint32_t post_trigger_left;
+static uint32_t generation;
+
+/* Overshoot only counts once the plant has been at or below the target
+ * since the last downward step, so cooling down after one is not an
+ * overshoot.
+ */
+static float last_target[CONFIG_HEATER_ZONE_COUNT];
+static bool overshoot_armed[CONFIG_HEATER_ZONE_COUNT];
+
+static K_MUTEX_DEFINE(trace_mutex);
+
+static size_t put_varint(uint8_t *buf, uint32_t value)
+{
+	size_t len = 0;
+
+	do {
+		buf[len] = value & 0x7f;
+		value >>= 7;
+		if (value) {
+			buf[len] |= 0x80;
+		}
+		len++;
+	} while (value);
+
+	return len;
+}
+
+static uint32_t zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static void chunk_open(void)
+{
+	current = (current + 1) % CONFIG_HEATER_TRACE_CHUNKS;
+	chunks[current].len = 0;
+	memset(&encoder, 0, sizeof(encoder));
+	generation++;
+}
+
+static void trace_reset(void)
+{
+	for (int i = 0; i < CONFIG_HEATER_TRACE_CHUNKS; i++) {
+		chunks[i].len = 0;
+	}
+
+	memset(&encoder, 0, sizeof(encoder));
+	state = TRACE_RUNNING;
+	trigger_reason = TRACE_TRIGGER_NONE;
+	generation++;
+}
+
+static void trigger_locked(enum trace_trigger reason, uint32_t now_ms)
+{
+	if (state != TRACE_RUNNING) {
+		return;
+	}
+
+	state = TRACE_TRIGGERED;
+	trigger_reason = reason;
+	trigger_time = now_ms;
+	post_trigger_left = CONFIG_HEATER_TRACE_POST_TRIGGER_SAMPLES;
+	generation++;
+
+	LOG_INF("Trace triggered, reason %d", reason);
+}
+
+void trace_recorder_add(int64_t now_ms, const struct trace_zone_sample *zones)
+{
+	struct trace_chunk *chunk;
+	uint32_t timestamp = (uint32_t)now_ms;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+
+	if (state == TRACE_FROZEN) {
+		goto exit;
+	}
+
+	if (CONFIG_HEATER_TRACE_CHUNK_SIZE - chunks[current].len < SAMPLE_MAX_SIZE) {
+		chunk_open();
+	}
+
+	chunk = &chunks[current];
+	chunk->len += put_varint(&chunk->data[chunk->len],
+				 timestamp - encoder.timestamp);
+	encoder.timestamp = timestamp;
+
+	for (int z = 0; z < CONFIG_HEATER_ZONE_COUNT; z++) {
+		int32_t values[3] = {
+			(int32_t)(zones[z].measured * 100),
+			(int32_t)(zones[z].target * 100),
+			(int32_t)(zones[z].duty * 100),
+		};
+
+		for (int v = 0; v < ARRAY_SIZE(values); v++) {
+			chunk->len += put_varint(&chunk->data[chunk->len],
+						 zigzag(values[v] - encoder.values[z][v]));
+			encoder.values[z][v] = values[v];
+		}
+
+		if (zones[z].target < last_target[z]) {
+			overshoot_armed[z] = false;
+		}
+		last_target[z] = zones[z].target;
+
+		if (zones[z].measured <= zones[z].target) {
+			overshoot_armed[z] = true;
+		} else if (overshoot_armed[z] &&
+			   zones[z].measured > zones[z].target + OVERSHOOT) {
+			trigger_locked(TRACE_TRIGGER_OVERSHOOT, timestamp);
+		}
+	}
+
+	/* Any earlier block may now be stale, as the current chunk grew */
+	generation++;
+
+	if (state == TRACE_TRIGGERED && post_trigger_left-- == 0) {
+		state = TRACE_FROZEN;
+		LOG_INF("Trace frozen");
+	}
+
+exit:
+	k_mutex_unlock(&trace_mutex);
+}
+
+void trace_recorder_trigger(enum trace_trigger reason)
+{
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	trigger_locked(reason, k_uptime_get_32());
+	k_mutex_unlock(&trace_mutex);
+}
+
+void trace_recorder_clear(void)
+{
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	trace_reset();
+	k_mutex_unlock(&trace_mutex);
+}
+
+enum trace_state trace_recorder_get_state(uint32_t *gen)
+{
+	enum trace_state ret;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	ret = state;
+	*gen = generation;
+	k_mutex_unlock(&trace_mutex);
+
+	return ret;
+}
+
+size_t trace_recorder_size(void)
+{
+	size_t size = TRACE_HEADER_SIZE;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+	for (int i = 0; i < CONFIG_HEATER_TRACE_CHUNKS; i++) {
+		if (chunks[i].len) {
+			size += CHUNK_LEN_SIZE + chunks[i].len;
+		}
+	}
+	k_mutex_unlock(&trace_mutex);
+
+	return size;
+}
+
+/* Copy the overlap of [src_offset, src_offset + src_len) with the request */
+static size_t copy_range(const uint8_t *src, size_t src_offset, size_t src_len,
+			 size_t offset, uint8_t *buf, size_t len)
+{
+	size_t start, end;
+
+	start = MAX(offset, src_offset);
+	end = MIN(offset + len, src_offset + src_len);
+	if (start >= end) {
+		return 0;
+	}
+
+	memcpy(&buf[start - offset], &src[start - src_offset], end - start);
+
+	return end - start;
+}
+
+size_t trace_recorder_read(size_t offset, uint8_t *buf, size_t len)
+{
+	uint8_t header[TRACE_HEADER_SIZE] = { 'H', 'T', TRACE_VERSION,
+					      CONFIG_HEATER_ZONE_COUNT };
+	size_t pos = TRACE_HEADER_SIZE;
+	size_t copied;
+
+	k_mutex_lock(&trace_mutex, K_FOREVER);
+
+	header[4] = state;
+	header[5] = trigger_reason;
+	sys_put_le32(trigger_time, &header[6]);
+	copied = copy_range(header, 0, sizeof(header), offset, buf, len);
+
+	/* Oldest chunk first, the current one is written last */
+	for (int i = 1; i <= CONFIG_HEATER_TRACE_CHUNKS; i++) {
+		const struct trace_chunk *chunk =
+			&chunks[(current + i) % CONFIG_HEATER_TRACE_CHUNKS];
+		uint8_t chunk_len[CHUNK_LEN_SIZE];
+
+		if (!chunk->len) {
+			continue;
+		}
+
+		sys_put_le16(chunk->len, chunk_len);
+		copied += copy_range(chunk_len, pos, sizeof(chunk_len),
+				     offset, buf, len);
+		pos += sizeof(chunk_len);
+		copied += copy_range(chunk->data, pos, chunk->len, offset, buf, len);
+		pos += chunk->len;
+	}
+
+	k_mutex_unlock(&trace_mutex);
+
+	return copied;
+}
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @defgroup trace_recorder On-device control loop trace recorder API
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __TRACE_RECORDER_H__
+#define __TRACE_RECORDER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum trace_state {
+	TRACE_RUNNING,		/* Recording, the oldest samples are overwritten */
+	TRACE_TRIGGERED,	/* Recording the post-trigger samples */
+	TRACE_FROZEN,		/* Recording stopped until cleared */
+};
+
+enum trace_trigger {
+	TRACE_TRIGGER_NONE,
+	TRACE_TRIGGER_MANUAL,
+	TRACE_TRIGGER_OVERSHOOT,
+	TRACE_TRIGGER_COMMS_TIMEOUT,
+};
+
+struct trace_zone_sample {
+	float measured;		/* degC */
+	float target;		/* degC */
+	float duty;		/* % */
+};
+
+/** @brief Add one control loop iteration.
+ *
+ * @note Called from the control loop only.
+ *
+ * @param[in] now_ms uptime in ms.
+ * @param[in] zones  CONFIG_HEATER_ZONE_COUNT zone samples.
+ */
+void trace_recorder_add(int64_t now_ms, const struct trace_zone_sample *zones);
+
+/** @brief Freeze the trace after the configured number of post-trigger
+ *         samples. Ignored unless the recorder is running.
+ */
+void trace_recorder_trigger(enum trace_trigger reason);
+
+/** @brief Drop all samples and restart recording.
+ */
+void trace_recorder_clear(void);
+
+/** @brief Get the recorder state and a generation counter, which
+ *         changes whenever the recorded data changes.
+ */
+enum trace_state trace_recorder_get_state(uint32_t *generation);
+
+/** @brief Get the size of the serialized trace in bytes.
+ */
+size_t trace_recorder_size(void);
+
+/** @brief Copy part of the serialized trace.
+ *
+ * The serialized trace is a header followed by the delta and varint
+ * encoded chunks, oldest first. See scripts/trace_decode.py for the format.
+ *
+ * @param[in]  offset byte offset into the serialized trace.
+ * @param[out] buf    destination buffer.
+ * @param[in]  len    size of the destination buffer.
+ *
+ * @return Number of bytes copied, 0 past the end of the trace.
+ */
+size_t trace_recorder_read(size_t offset, uint8_t *buf, size_t len);
+
+#endif
+
+/**
+ * @}
+ */
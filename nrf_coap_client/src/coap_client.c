@@ -11,10 +11,10 @@
 #include <zephyr/device.h>
 #include <zephyr/pm/device.h>
 
-#include <zephyr/drivers/counter.h>
 #include <zephyr/drivers/i2c.h>
 
 #include "coap_client_utils.h"
+#include "scheduler.h"
 
 LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
@@ -22,8 +22,10 @@ LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 #define COUNTER_LED DK_LED2
 #define MTD_SED_LED DK_LED3
 
-#define ALARM_DELAY 1000000 /*1 second, units for function is usec*/
-#define ALARM_CHANNEL 0
+#define REPORT_PERIOD_MS 5000
+
+BUILD_ASSERT(REPORT_PERIOD_MS > CONFIG_SCHEDULER_COALESCE_MS,
+	     "The report period must be longer than the coalescing window");
 
 /*Variables for storing sensor data*/
 static uint16_t temperature;
@@ -31,6 +33,8 @@ static uint16_t humidity;
 
 static bool isLedOn = 0;
 
+static struct scheduler_job report_job;
+
 static void on_ot_connect(struct k_work *item)
 {
 	ARG_UNUSED(item);
@@ -84,9 +88,9 @@ static void on_button_changed(uint32_t button_state, uint32_t has_changed)
 	}
 }
 
-static counter_top_callback_t submit_read_sensor_work (const struct device *dev, void *user_data){
-	ARG_UNUSED(user_data);
-	//printk("countering every second!\n");
+static void report_sensor_data(struct scheduler_job *job)
+{
+	ARG_UNUSED(job);
 	dk_set_led(COUNTER_LED, !isLedOn); 
 	isLedOn = !isLedOn;
 
@@ -118,22 +122,12 @@ void main(void)
 		return;
 	}
 
-	const struct device* rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc2));
-	counter_stop(rtc_dev);
-	struct counter_top_cfg counter_cfg;
-	counter_cfg.ticks = counter_us_to_ticks(rtc_dev, 5*ALARM_DELAY);
-	counter_cfg.callback = submit_read_sensor_work;
-	counter_cfg.user_data = &counter_cfg;
-	ret = counter_set_top_value(rtc_dev, &counter_cfg);
-
-
-	if (-EINVAL == ret) {
-		printk("Alarm settings invalid\n");
-	} else if (-ENOTSUP == ret) {
-		printk("Alarm setting request not supported\n");
-	} else if (ret != 0) {
-		printk("Error\n");
+	ret = scheduler_init();
+	if (ret) {
+		LOG_ERR("Cannot init scheduler, (error: %d)", ret);
+		return;
 	}
+	scheduler_job_init(&report_job, report_sensor_data);
 
 	coap_client_utils_init(on_ot_connect, on_ot_disconnect,
 			       on_mtd_mode_toggle);
@@ -143,5 +137,8 @@ void main(void)
 		printk("waiting for provisioning");
 		k_sleep(K_SECONDS(10));
 	}
-	counter_start(rtc_dev);
+	ret = scheduler_job_periodic(&report_job, REPORT_PERIOD_MS, 0);
+	if (ret) {
+		LOG_ERR("Cannot schedule reports, (error: %d)", ret);
+	}
 }
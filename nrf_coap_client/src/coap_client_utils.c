@@ -16,6 +16,7 @@
 
 #include "coap_server_client_interface.h"
 #include "coap_client_utils.h"
+#include "hot_path_log.h"
 
 LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
@@ -82,7 +83,7 @@ static void poll_period_response_set(void)
 		error = otLinkSetPollPeriod(instance, RESPONSE_POLL_PERIOD);
 		__ASSERT(error == OT_ERROR_NONE, "Failed to set pool period");
 
-		LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
+		HOT_LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
 	}
 }
 
@@ -99,7 +100,7 @@ static void poll_period_restore(void)
 		error = otLinkSetPollPeriod(instance, poll_period);
 		__ASSERT_NO_MSG(error == OT_ERROR_NONE);
 
-		LOG_INF("Poll Period: %dms restored", poll_period);
+		HOT_LOG_INF("Poll Period: %dms restored", poll_period);
 		poll_period = 0;
 	}
 }
@@ -180,7 +181,7 @@ static void send_sensor_data(struct k_work *item)
 		return;
 	}
 
-	LOG_INF("Send 'light' request to: %s", unique_local_addr_str);
+	HOT_LOG_INF("Send 'light' request to: %s", unique_local_addr_str);
 	//thread_analyzer_print();
 	coap_send_request(COAP_METHOD_PUT,
 			  (const struct sockaddr *)&unique_local_addr,
@@ -0,0 +1,126 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Simulate the report timing of a fleet that powers up at the same moment.
+
+Every node runs the firmware's phase logic: runs are aligned to multiples
+of the period since boot, offset by no phase, an EUI-64 hash phase, or a
+server-assigned slot. The script counts how many reports overlap on air.
+
+Usage:
+    python3 phase_sim.py --nodes 300 --period 5000
+"""
+
+import argparse
+import random
+
+MASK64 = 2**64 - 1
+
+# 802.15.4 at 250 kbit/s, preamble, SFD and PHR precede the PSDU
+US_PER_BYTE = 32
+PHY_HEADER_BYTES = 6
+
+
+def eui64_hash(eui):
+    """MurmurHash3 finalizer over the EUI-64, as coap_client_get_phase()."""
+    value = int.from_bytes(eui, "big")
+    value ^= value >> 33
+    value = (value * 0xFF51AFD7ED558CCD) & MASK64
+    value ^= value >> 33
+    value = (value * 0xC4CEB9FE1A85EC53) & MASK64
+    value ^= value >> 33
+    return value
+
+
+def eui64s(count, sequential, rng):
+    """A production batch shares the OUI and has consecutive serials."""
+    base = rng.getrandbits(40)
+    for i in range(count):
+        serial = base + i if sequential else rng.getrandbits(40)
+        yield bytes([0xF4, 0xCE, 0x36]) + (serial & (2**40 - 1)).to_bytes(5, "big")
+
+
+def phases(mode, args, rng):
+    if mode == "none":
+        return [0] * args.nodes
+    if mode == "eui64":
+        return [eui64_hash(eui) % args.period
+                for eui in eui64s(args.nodes, not args.random_eui, rng)]
+    slots = args.slots or args.nodes
+    return [args.period * (i % slots) // slots for i in range(args.nodes)]
+
+
+def simulate(mode, args, rng):
+    airtime_us = (args.frame_bytes + PHY_HEADER_BYTES) * US_PER_BYTE
+    starts = []
+
+    for phase in phases(mode, args, rng):
+        # Nodes boot within a few ms of each other after a power cycle,
+        # their uptime clocks drift apart by the crystal tolerance.
+        boot_us = rng.uniform(0, args.boot_jitter) * 1000
+        drift = 1 + rng.uniform(-args.ppm, args.ppm) * 1e-6
+        first = args.period + phase
+        for n in range(args.reports):
+            local_ms = first + n * args.period
+            wake_us = rng.uniform(0, args.wake_jitter) * 1000
+            starts.append(boot_us + local_ms * 1000 * drift + wake_us)
+
+    starts.sort()
+
+    # A report contends when another one starts before it is off the air
+    contended = 0
+    for i, start in enumerate(starts):
+        before = i > 0 and start - starts[i - 1] < airtime_us
+        after = i + 1 < len(starts) and starts[i + 1] - start < airtime_us
+        contended += before or after
+
+    # Busiest window, a rough measure of the parent's queue depth
+    busiest = 0
+    window_us = args.window * 1000
+    j = 0
+    for i, start in enumerate(starts):
+        while starts[j] < start - window_us:
+            j += 1
+        busiest = max(busiest, i - j + 1)
+
+    return len(starts), contended, busiest
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--nodes", type=int, default=200)
+    parser.add_argument("--period", type=int, default=5000,
+                        help="report period [ms]")
+    parser.add_argument("--reports", type=int, default=20,
+                        help="reports per node to simulate")
+    parser.add_argument("--slots", type=int, default=0,
+                        help="slots the server hands out, default one per node")
+    parser.add_argument("--frame-bytes", type=int, default=64,
+                        help="PSDU length of one report")
+    parser.add_argument("--boot-jitter", type=float, default=20,
+                        help="spread of boot times after a power cycle [ms]")
+    parser.add_argument("--wake-jitter", type=float, default=2,
+                        help="alarm to transmission latency spread [ms]")
+    parser.add_argument("--ppm", type=float, default=20,
+                        help="clock tolerance of the nodes [ppm]")
+    parser.add_argument("--window", type=float, default=10,
+                        help="window for the busiest-window count [ms]")
+    parser.add_argument("--random-eui", action="store_true",
+                        help="random EUI-64s instead of consecutive serials")
+    parser.add_argument("--seed", type=int, default=1)
+    args = parser.parse_args()
+
+    print("%-6s %8s %10s %8s %8s" %
+          ("phase", "reports", "contended", "share", "busiest"))
+    for mode in ("none", "eui64", "slot"):
+        rng = random.Random(args.seed)
+        total, contended, busiest = simulate(mode, args, rng)
+        print("%-6s %8d %10d %7.1f%% %8d" %
+              (mode, total, contended, 100 * contended / total, busiest))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+#
+# Copyright (c) 2022 Nordic Semiconductor ASA
+#
+# SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+#
+
+"""Compare the on-air cost of a report in plain text, OSCORE and DTLS.
+
+Message sizes follow RFC 7252 (CoAP), RFC 8613 (OSCORE) and RFC 6347 with
+TLS_PSK_WITH_AES_128_CCM_8 (DTLS 1.2). DTLS also pays for an abbreviated
+handshake whenever a session is resumed, spread over the reports sent in
+the session. Frame counts use 6LoWPAN fragmentation over 802.15.4.
+
+The figures are the protocol minimum for the given field lengths. Check
+them against the "sensor oscore" shell counters of a running node.
+
+Usage:
+    python3 security_overhead.py --payload 12 --reports-per-session 50
+"""
+
+import argparse
+
+# 802.15.4 at 250 kbit/s, preamble, SFD and PHR precede the PSDU
+US_PER_BYTE = 32
+PHY_HEADER_BYTES = 6
+PSDU_MAX = 127
+# FCF, sequence, PAN id, short addresses, auxiliary security header,
+# MIC-32 and FCS of a Thread data frame
+MAC_OVERHEAD = 2 + 1 + 2 + 2 + 2 + 6 + 4 + 2
+MAC_ACK_BYTES = 5
+TURNAROUND_US = 192
+FRAG1_HEADER = 4
+FRAGN_HEADER = 5
+
+COAP_HEADER = 4
+OPTION_OSCORE = 9
+OPTION_URI_PATH = 11
+OPTION_CONTENT_FORMAT = 12
+AEAD_TAG = 8
+
+DTLS_RECORD = 13 + 8 + AEAD_TAG		# header, explicit nonce, tag
+DTLS_PLAIN_RECORD = 13
+DTLS_HANDSHAKE = 12
+RANDOM = 32
+SESSION_ID = 32
+VERIFY_DATA = 12
+
+
+def ext_len(value):
+    return 0 if value < 13 else 1 if value < 269 else 2
+
+
+def options_size(options):
+    """Encoded size of (number, length) options, RFC 7252 section 3.1."""
+    size = 0
+    last = 0
+    for number, length in sorted(options):
+        size += 1 + ext_len(number - last) + ext_len(length) + length
+        last = number
+    return size
+
+
+def coap_size(token, options, payload):
+    return (COAP_HEADER + token + options_size(options) +
+            (1 + payload if payload else 0))
+
+
+def piv_len(ssn):
+    return max(1, (ssn.bit_length() + 7) // 8)
+
+
+def oscore_request(token, inner_options, payload, sender_id, id_context, ssn):
+    # Flags, Partial IV, kid context with its length byte, kid
+    value = 1 + piv_len(ssn) + sender_id
+    if id_context:
+        value += 1 + id_context
+    plaintext = 1 + options_size(inner_options) + (1 + payload if payload else 0)
+    return (COAP_HEADER + token + options_size([(OPTION_OSCORE, value)]) +
+            1 + plaintext + AEAD_TAG)
+
+
+def oscore_response(token, payload):
+    plaintext = 1 + (1 + payload if payload else 0)
+    return (COAP_HEADER + token + options_size([(OPTION_OSCORE, 0)]) +
+            1 + plaintext + AEAD_TAG)
+
+
+def dtls_resumption(cookie):
+    """Datagrams of an abbreviated handshake, client and server side."""
+    client_hello = (2 + RANDOM + 1 + SESSION_ID + 1 + cookie +
+                    2 + 2 + 1 + 1)
+    hello = DTLS_PLAIN_RECORD + DTLS_HANDSHAKE + client_hello
+    server_hello = DTLS_PLAIN_RECORD + DTLS_HANDSHAKE + (
+        2 + RANDOM + 1 + SESSION_ID + 2 + 1)
+    ccs = DTLS_PLAIN_RECORD + 1
+    finished = DTLS_RECORD + DTLS_HANDSHAKE + VERIFY_DATA
+
+    client = [hello, ccs + finished]
+    server = [server_hello + ccs + finished]
+    round_trips = 1
+    if cookie:
+        verify = DTLS_PLAIN_RECORD + DTLS_HANDSHAKE + 2 + 1 + cookie
+        client.insert(0, hello - cookie)
+        server.insert(0, verify)
+        round_trips += 1
+    return client, server, round_trips
+
+
+def frames(udp_payload, lowpan_header):
+    """802.15.4 frames carrying one UDP datagram, and their PSDU bytes."""
+    room = PSDU_MAX - MAC_OVERHEAD
+    size = lowpan_header + udp_payload
+    if size <= room:
+        return [MAC_OVERHEAD + size]
+
+    # Fragment payloads other than the last are multiples of 8 bytes
+    first = (room - FRAG1_HEADER) // 8 * 8
+    rest = (room - FRAGN_HEADER) // 8 * 8
+    psdus = [MAC_OVERHEAD + FRAG1_HEADER + first]
+    size -= first
+    while size > 0:
+        chunk = min(rest, size)
+        psdus.append(MAC_OVERHEAD + FRAGN_HEADER + chunk)
+        size -= chunk
+    return psdus
+
+
+def airtime_us(psdus):
+    per_ack = TURNAROUND_US + (PHY_HEADER_BYTES + MAC_ACK_BYTES) * US_PER_BYTE
+    return sum((PHY_HEADER_BYTES + psdu) * US_PER_BYTE + per_ack
+               for psdu in psdus)
+
+
+def datagram_cost(sizes, lowpan_header):
+    psdus = [psdu for size in sizes for psdu in frames(size, lowpan_header)]
+    return sum(sizes), len(psdus), airtime_us(psdus)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--payload", type=int, default=12,
+                        help="report payload [bytes], \"23.4/45/5000\" is 12")
+    parser.add_argument("--path", default="sensors/f4ce360000000001",
+                        help="Uri-Path of the report")
+    parser.add_argument("--token", type=int, default=8,
+                        help="token length [bytes]")
+    parser.add_argument("--sender-id", type=int, default=1,
+                        help="OSCORE sender id length [bytes]")
+    parser.add_argument("--id-context", type=int, default=6,
+                        help="OSCORE ID context length, generation included")
+    parser.add_argument("--ssn", type=int, default=1000,
+                        help="OSCORE sender sequence number, sets the Partial IV")
+    parser.add_argument("--confirmable", action="store_true",
+                        help="count the acknowledgement or response as well")
+    parser.add_argument("--cookie", type=int, default=0,
+                        help="DTLS cookie length, 0 if the server skips "
+                        "HelloVerifyRequest on resumption")
+    parser.add_argument("--reports-per-session", type=int, default=50,
+                        help="reports sent before a DTLS session is resumed")
+    parser.add_argument("--lowpan-header", type=int, default=10,
+                        help="compressed IPv6 and UDP headers [bytes]")
+    args = parser.parse_args()
+
+    path = [(OPTION_URI_PATH, len(segment))
+            for segment in args.path.split("/") if segment]
+    options = path + [(OPTION_CONTENT_FORMAT, 0)]
+
+    plain = coap_size(args.token, options, args.payload)
+    oscore = oscore_request(args.token, options, args.payload,
+                            args.sender_id, args.id_context, args.ssn)
+    schemes = [
+        ("plain", [plain], [COAP_HEADER], 0),
+        ("oscore", [oscore], [oscore_response(args.token, 0)], 0),
+        ("dtls", [plain + DTLS_RECORD], [COAP_HEADER + DTLS_RECORD], 0),
+    ]
+
+    client, server, round_trips = dtls_resumption(args.cookie)
+    handshake = client + server
+
+    print("%-12s %8s %7s %11s %10s" %
+          ("scheme", "bytes", "frames", "airtime us", "extra RTT"))
+    for name, request, response, extra in schemes:
+        sizes = request + (response if args.confirmable else [])
+        total, count, air = datagram_cost(sizes, args.lowpan_header)
+        print("%-12s %8d %7d %11d %10d" % (name, total, count, air, extra))
+
+    # The resumption handshake, and its share of every report
+    total, count, air = datagram_cost(handshake, args.lowpan_header)
+    print("%-12s %8d %7d %11d %10d" %
+          ("dtls-resume", total, count, air, round_trips))
+    sizes = schemes[2][1] + (schemes[2][2] if args.confirmable else [])
+    report_total, report_count, report_air = datagram_cost(
+        sizes, args.lowpan_header)
+    n = args.reports_per_session
+    print("%-12s %8.1f %7.2f %11.0f %10.2f" %
+          ("dtls/report", report_total + total / n,
+           report_count + count / n, report_air + air / n, round_trips / n))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "adaptive.h"
+#include "am2320.h"
+
+LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
+
+#define WINDOW CONFIG_SENSOR_ADAPTIVE_WINDOW
+#define MIN_PERIOD_MS CONFIG_SENSOR_ADAPTIVE_MIN_PERIOD_MS
+#define MAX_PERIOD_MS CONFIG_SENSOR_ADAPTIVE_MAX_PERIOD_MS
+
+/* Only touched from the system workqueue */
+static int16_t temperatures[WINDOW];
+static int16_t humidities[WINDOW];
+static uint8_t count;
+static uint8_t head;
+static uint32_t period_ms = MIN_PERIOD_MS;
+static uint32_t temperature_variance;
+
+static uint32_t variance(const int16_t *values, uint8_t n)
+{
+	int32_t sum = 0;
+	int64_t squares = 0;
+
+	for (int i = 0; i < n; i++) {
+		sum += values[i];
+		squares += values[i] * values[i];
+	}
+
+	/* n * sum(x^2) - sum(x)^2 over n^2, exact in integers */
+	return (n * squares - (int64_t)sum * sum) / (n * n);
+}
+
+uint32_t adaptive_update(uint16_t temperature, uint16_t humidity)
+{
+	const uint32_t temp_limit = CONFIG_SENSOR_ADAPTIVE_TEMP_THRESHOLD *
+				    CONFIG_SENSOR_ADAPTIVE_TEMP_THRESHOLD;
+	const uint32_t hum_limit = CONFIG_SENSOR_ADAPTIVE_HUM_THRESHOLD *
+				   CONFIG_SENSOR_ADAPTIVE_HUM_THRESHOLD;
+	uint32_t humidity_variance;
+	uint32_t previous = period_ms;
+
+	temperatures[head] = am2320_temperature(temperature);
+	humidities[head] = humidity;
+	head = (head + 1) % WINDOW;
+	count = MIN(count + 1, WINDOW);
+
+	if (count < 2) {
+		return period_ms;
+	}
+
+	temperature_variance = variance(temperatures, count);
+	humidity_variance = variance(humidities, count);
+
+	if (temperature_variance > temp_limit || humidity_variance > hum_limit) {
+		/* Something is happening, catch the transient */
+		period_ms = MIN_PERIOD_MS;
+	} else if (count == WINDOW &&
+		   temperature_variance <= temp_limit / 16 &&
+		   humidity_variance <= hum_limit / 16) {
+		/* Standard deviation within a quarter of the threshold */
+		period_ms = MIN(period_ms * 2, MAX_PERIOD_MS);
+	}
+
+	if (period_ms != previous) {
+		LOG_INF("Sampling period %u ms", period_ms);
+	}
+
+	return period_ms;
+}
+
+uint32_t adaptive_get_period(void)
+{
+	return period_ms;
+}
+
+uint32_t adaptive_get_temperature_variance(void)
+{
+	return temperature_variance;
+}
+
+void adaptive_reset(void)
+{
+	count = 0;
+	head = 0;
+	temperature_variance = 0;
+	period_ms = MIN_PERIOD_MS;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file
+ * @defgroup adaptive Variance driven sampling period
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __ADAPTIVE_H__
+#define __ADAPTIVE_H__
+
+#include <stdint.h>
+
+/** @brief Feed a reading and get the period until the next one.
+ *
+ * The period drops straight to the minimum when the recent readings of
+ * either quantity vary by more than their threshold, and doubles up to
+ * the maximum while they stay within a quarter of it.
+ *
+ * @param[in] temperature Temperature in 0.1 degC, as read from the AM2320.
+ * @param[in] humidity    Relative humidity in 0.1 %.
+ *
+ * @return Sampling period in milliseconds.
+ */
+uint32_t adaptive_update(uint16_t temperature, uint16_t humidity);
+
+/** @brief Get the current sampling period in milliseconds.
+ */
+uint32_t adaptive_get_period(void);
+
+/** @brief Get the variance of the recent temperature readings.
+ *
+ * @return Variance in (0.1 degC)^2.
+ */
+uint32_t adaptive_get_temperature_variance(void);
+
+/** @brief Forget the history and restart from the minimum period.
+ */
+void adaptive_reset(void);
+
+#endif
+
+/**
+ * @}
+ */
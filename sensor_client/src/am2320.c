@@ -12,6 +12,8 @@
 
 #include <zephyr/drivers/i2c.h>
 
+#include "hot_path_log.h"
+
 #define SENSOR_ADDRESS 0x5C
 
 LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
@@ -56,7 +58,7 @@ int getSensorValues(const struct device* dev, uint16_t* humidity,uint16_t* tempe
 	6,7: CRC checksum
 	*/
 
-    LOG_INF("RECEIVED DATA!");
+	HOT_LOG_INF("RECEIVED DATA!");
 	*humidity = receive_buffer[2] << 8 | receive_buffer[3];
 	*temperature = receive_buffer[4] << 8 | receive_buffer[5];
 
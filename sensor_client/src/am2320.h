@@ -1,6 +1,8 @@
 #ifndef _AM2320_H__
 #define _AM2320_H__
 
+#include <zephyr/device.h>
+
 /** @brief Function to initialise an i2c device. 
  * 
 */
@@ -13,4 +15,13 @@ int initI2C (struct device* dev);
 
 int getSensorValues(const struct device* dev, uint16_t* humidity,uint16_t* temperature);
 
+/** @brief Convert a temperature read from the AM2320 to 0.1 degC.
+ *
+ * The sensor reports sign and magnitude, bit 15 set below 0 degC.
+ */
+static inline int16_t am2320_temperature(uint16_t raw)
+{
+	return (raw & 0x8000) ? -(int16_t)(raw & 0x7fff) : (int16_t)raw;
+}
+
 #endif 
\ No newline at end of file
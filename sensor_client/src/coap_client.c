@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
  */
 
+#include <stdio.h>
 #include <zephyr/kernel.h>
 #include <dk_buttons_and_leds.h>
 #include <zephyr/logging/log.h>
@@ -13,13 +14,18 @@
 
 
 
-#include <zephyr/drivers/counter.h>
 #include <zephyr/drivers/i2c.h>
 
 #include <zephyr/usb/usb_device.h>
 
 #include "coap_client_utils.h"
+#include "coap_server.h"
 #include "am2320.h"
+#include "adaptive.h"
+#include "energy.h"
+#include "node_config.h"
+#include "pipeline_trace.h"
+#include "scheduler.h"
 
 LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
@@ -27,16 +33,12 @@ LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 #define COUNTER_LED DK_LED2
 #define MTD_SED_LED DK_LED3
 
-#define ALARM_DELAY 1000000 /*1 second, units for function is usec*/
-#define ALARM_CHANNEL 0
-
 /*Variables for storing sensor data*/
 static const struct device* i2c_dev = DEVICE_DT_GET(DT_NODELABEL(i2c0));
 static uint16_t temperature = 100;
 static uint16_t humidity = 100;
 
-/*Variable for work struct*/
-struct k_work fetch_sensor_work;
+static struct scheduler_job fetch_sensor_job;
 
 static bool isLedOn = 0;
 
@@ -72,24 +74,155 @@ static void on_mtd_mode_toggle(uint32_t med)
 	dk_set_led(MTD_SED_LED, med);
 }
 
-/*Function provided to k_work object, retrieves sensors value*/
-static void fetch_sensor_data(struct k_work *item){
-	ARG_UNUSED(item);
-	getSensorValues(i2c_dev, &humidity, &temperature);
+#if defined(CONFIG_SENSOR_ADAPTIVE)
+#define SAMPLE_PERIOD_MS CONFIG_SENSOR_ADAPTIVE_MIN_PERIOD_MS
+#else
+#define SAMPLE_PERIOD_MS CONFIG_SENSOR_REPORT_PERIOD_MS
+#endif
+
+static uint32_t sample_period_ms = SAMPLE_PERIOD_MS;
+static bool sampling_started;
+
+BUILD_ASSERT(SAMPLE_PERIOD_MS > CONFIG_SCHEDULER_COALESCE_MS,
+	     "The sample period must be longer than the coalescing window");
+
+static int start_sampling(uint32_t period_ms)
+{
+	/* Spread the reports of nodes that came up together */
+	int ret = scheduler_job_periodic(&fetch_sensor_job, period_ms,
+					 coap_client_get_phase(period_ms));
+
+	if (ret) {
+		LOG_ERR("Cannot sample every %u ms, (error: %d)", period_ms,
+			ret);
+	}
+
+	return ret;
 }
 
+/* Move the sampling job when the signal asks for another period */
+static void adapt_sampling_period(void)
+{
+	uint32_t period_ms = adaptive_update(temperature, humidity);
+
+	/* The report of this reading already carries the new period */
+	coap_client_set_sample_period(period_ms);
+
+	if (period_ms != sample_period_ms) {
+		sample_period_ms = period_ms;
+		start_sampling(period_ms);
+	}
+}
+
+/* Idle poll period when none is configured */
+static uint32_t default_poll_period(void)
+{
+#if defined(CONFIG_SENSOR_POLL_WITH_REPORT)
+	/* Reports poll on their own, see coap_client_utils_init() */
+	return MAX(CONFIG_OPENTHREAD_POLL_PERIOD, 2 * sample_period_ms);
+#else
+	return 0;
+#endif
+}
+
+/* Apply parameters changed over CoAP, from the shell or loaded at boot */
+static int on_config_changed(enum node_config_id id, int32_t value)
+{
+	int ret;
+
+	switch (id) {
+	case NODE_CONFIG_PERIOD:
+		sample_period_ms = value;
+		if (sampling_started) {
+			ret = start_sampling(value);
+			if (ret) {
+				return ret;
+			}
+		}
+		if (node_config_get(NODE_CONFIG_POLL) == 0) {
+			return coap_client_set_poll_period(default_poll_period());
+		}
+		return 0;
+
+	case NODE_CONFIG_POLL:
+		return coap_client_set_poll_period(value ? value :
+						   default_poll_period());
+
+	case NODE_CONFIG_MODE:
+		return coap_client_set_link_mode(value);
+
+	case NODE_CONFIG_CSL:
+		return coap_client_set_csl_period(value);
+
+	default:
+		return 0;
+	}
+}
 
-/*Callback provided to counter top config*/
-static void submit_read_sensor_work (const struct device *dev, void *user_data){
-	ARG_UNUSED(dev);
-	ARG_UNUSED(user_data);
-	LOG_INF("countering every second!\n");
-	dk_set_led(COUNTER_LED, !isLedOn); 
+#if defined(CONFIG_SENSOR_ALARMS)
+/* Drop this far below a threshold before the alarm can fire again [0.1] */
+#define TEMP_ALARM_HYSTERESIS 10
+#define HUM_ALARM_HYSTERESIS 50
+
+/* Raise an alarm on the first reading over a threshold, readings are
+ * in tenths of a degree and of a percent
+ */
+static void check_alarms(int16_t temp, uint16_t hum)
+{
+	static bool temp_raised;
+	static bool hum_raised;
+	static bool have_last;
+	static uint16_t last_hum;
+	int32_t temp_max = node_config_get(NODE_CONFIG_TEMP_MAX) * 10;
+	int32_t hum_max = node_config_get(NODE_CONFIG_HUM_MAX) * 10;
+	int32_t hum_step = node_config_get(NODE_CONFIG_HUM_STEP) * 10;
+	char text[24];
+
+	if (!temp_raised && temp >= temp_max) {
+		temp_raised = true;
+		snprintf(text, sizeof(text), "temp=%.1f", temp / 10.0);
+		coap_client_send_alarm(text);
+	} else if (temp_raised && temp < temp_max - TEMP_ALARM_HYSTERESIS) {
+		temp_raised = false;
+	}
+
+	if (!hum_raised && (hum >= hum_max ||
+	    (hum_step && have_last && hum >= last_hum + hum_step))) {
+		hum_raised = true;
+		snprintf(text, sizeof(text), "hum=%.1f", hum / 10.0);
+		coap_client_send_alarm(text);
+	} else if (hum_raised && hum < hum_max - HUM_ALARM_HYSTERESIS) {
+		hum_raised = false;
+	}
+
+	last_hum = hum;
+	have_last = true;
+}
+#endif
+
+/*Scheduler job, retrieves sensors value*/
+static void fetch_sensor_data(struct scheduler_job *job){
+	ARG_UNUSED(job);
+	dk_set_led(COUNTER_LED, !isLedOn);
 	isLedOn = !isLedOn;
 
-	k_work_submit(&fetch_sensor_work);
+	PIPELINE_TRACE(TRACE_I2C_START, 0, 0);
+	getSensorValues(i2c_dev, &humidity, &temperature);
+	PIPELINE_TRACE(TRACE_I2C_DONE, temperature, humidity);
+
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_count(ENERGY_EVENT_SAMPLE);
+	}
+
+	if (IS_ENABLED(CONFIG_SENSOR_ADAPTIVE)) {
+		adapt_sampling_period();
+	}
 
+	/* Report the fresh sample in the same wake-up */
 	if (isProvisioned()){
+#if defined(CONFIG_SENSOR_ALARMS)
+		check_alarms(am2320_temperature(temperature), humidity);
+#endif
 		coap_client_send_sensor_data(temperature, humidity);
 	}
 }
@@ -117,8 +250,15 @@ void main(void)
 		return;
 	}
 
-	/*Initialise k_work related stuff*/
-	k_work_init(&fetch_sensor_work, fetch_sensor_data);
+	ret = scheduler_init();
+	if (ret) {
+		LOG_ERR("Cannot init scheduler, (error: %d)", ret);
+		return;
+	}
+	scheduler_job_init(&fetch_sensor_job, fetch_sensor_data);
+
+	/* Parameters tuned at runtime survive a reboot */
+	node_config_init();
 
 	/*Initialise I2C peripheral for communicating with the sensor*/
 	ret = initI2C(i2c_dev);
@@ -126,35 +266,27 @@ void main(void)
 		LOG_ERR("I2C initialisation error code: %d", ret);
 	}
 	LOG_INF("dev %p name %s\n", i2c_dev, i2c_dev->name);
-	/*Initialise RTC counter device, provide top value and callback function*/
 
-	const struct device* rtc_dev = DEVICE_DT_GET(DT_NODELABEL(rtc2));
-	counter_stop(rtc_dev);
-	struct counter_top_cfg counter_cfg;
-	counter_cfg.ticks = counter_us_to_ticks(rtc_dev, 5*ALARM_DELAY);
-	counter_cfg.callback = submit_read_sensor_work;
-	counter_cfg.user_data = &counter_cfg;
-	ret = counter_set_top_value(rtc_dev, &counter_cfg);
 
+	coap_client_utils_init(on_ot_connect, on_ot_disconnect,
+			       on_mtd_mode_toggle);
+	node_config_set_callback(on_config_changed);
 
-	if (-EINVAL == ret) {
-		printk("Alarm settings invalid\n");
-	} else if (-ENOTSUP == ret) {
-		printk("Alarm setting request not supported\n");
-	} else if (ret != 0) {
-		printk("Error\n");
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_init();
 	}
 
-
-	coap_client_utils_init(on_ot_connect, on_ot_disconnect,
-			       on_mtd_mode_toggle);
+	if (IS_ENABLED(CONFIG_SENSOR_COAP_SERVER)) {
+		coap_server_init();
+	}
 
 	while (!isProvisioned()){
 		coap_client_send_provisioning_request();
 		printk("waiting for provisioning");
 		k_sleep(K_SECONDS(10));
 	}
-	counter_start(rtc_dev);
+	start_sampling(sample_period_ms);
+	sampling_started = true;
 
 
 	// while (1){
@@ -10,14 +10,27 @@
 #include <zephyr/logging/log.h>
 #include <zephyr/net/openthread.h>
 #include <zephyr/net/socket.h>
+#include <openthread/coap.h>
+#include <openthread/link.h>
 #include <openthread/thread.h>
 
 #include <zephyr/debug/thread_analyzer.h>
 
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "coap_server_client_interface.h"
 #include "coap_client_utils.h"
+#include "alarm.h"
+#include "am2320.h"
+#include "csl.h"
+#include "energy.h"
+#include "hot_path_log.h"
+#include "oscore_client.h"
+#include "pipeline_trace.h"
+#include "tx_queue.h"
 
 LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
@@ -25,8 +38,6 @@ LOG_MODULE_REGISTER(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
 
 static uint32_t poll_period;
 
-static bool is_connected;
-
 // static struct k_work send_sensor_data_work;
 static struct k_work toggle_MTD_SED_work;
 static struct k_work on_connect_work;
@@ -36,13 +47,37 @@ static struct k_work on_disconnect_work;
 //Ease passing of data to the function
 //Contains k_work object inside as well
 
-static struct work_var_container provisioning_container;
 static struct work_sensor_container sensor_data_container;
 
+/* Requests waiting in the transmit queue */
+enum tx_kind {
+	TX_KIND_PROVISIONING,
+	TX_KIND_SENSOR_DATA,
+	TX_KIND_ALARM,
+};
+
+#if CONFIG_SENSOR_REPORT_BATCH > 1
+/* Readings waiting to fill a telemetry report */
+static char batch[CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD];
+static uint32_t batch_count;
+#endif
+
 mtd_mode_toggle_cb_t on_mtd_mode_toggle;
 
 /* Options supported by the server */
+#if defined(CONFIG_SENSOR_NODE_ID)
+/* Decimal id assigned at provisioning, or the EUI-64 as 16 hex digits */
+static char node_id[2 * sizeof(otExtAddress) + 1];
+static const char *const node_option[] = { SENSORS_URI_PATH, node_id, NULL };
+#if defined(CONFIG_SENSOR_ALARMS)
+static const char *const alarm_option[] = { ALARM_URI_PATH, node_id, NULL };
+#endif
+#else
 static const char *const node_option[] = { NODE1_URI_PATH, NULL };
+#if defined(CONFIG_SENSOR_ALARMS)
+static const char *const alarm_option[] = { ALARM_URI_PATH, NULL };
+#endif
+#endif
 static const char *const provisioning_option[] = { PROVISIONING_URI_PATH, NULL };
 
 /* Thread multicast mesh local address */
@@ -54,6 +89,18 @@ static struct sockaddr_in6 multicast_local_addr = {
 	.sin6_scope_id = 0U
 };
 
+#if defined(CONFIG_SENSOR_BINDING_GROUP)
+/* Heaters bound to this sensor listen on this group, they tell the
+ * sensors apart by source address.
+ */
+static const char *const binding_option[] = { NODE1_URI_PATH, NULL };
+static struct sockaddr_in6 binding_group_addr = {
+	.sin6_family = AF_INET6,
+	.sin6_port = htons(COAP_PORT),
+	.sin6_scope_id = 0U
+};
+#endif
+
 /* Variable for storing server address acquiring in provisioning handshake */
 static char unique_local_addr_str[INET6_ADDRSTRLEN] = {0};
 static struct sockaddr_in6 unique_local_addr = {
@@ -63,6 +110,31 @@ static struct sockaddr_in6 unique_local_addr = {
 	.sin6_scope_id = 0U
 };
 
+/* The provisioning reply and the failover switch servers while requests
+ * are sent from other threads, senders work on a copy
+ */
+static struct k_spinlock server_lock;
+
+/* Called with server_lock held */
+static void server_addr_set(const struct in6_addr *addr)
+{
+	unique_local_addr.sin6_addr = *addr;
+	inet_ntop(AF_INET6, addr, unique_local_addr_str,
+		  sizeof(unique_local_addr_str));
+}
+
+/* Copy the server address, and its text form unless str is NULL */
+static void server_addr_get(struct sockaddr_in6 *addr, char *str)
+{
+	k_spinlock_key_t key = k_spin_lock(&server_lock);
+
+	*addr = unique_local_addr;
+	if (str) {
+		memcpy(str, unique_local_addr_str, INET6_ADDRSTRLEN);
+	}
+	k_spin_unlock(&server_lock, key);
+}
+
 static bool is_mtd_in_med_mode(otInstance *instance)
 {
 	return otThreadGetLinkMode(instance).mRxOnWhenIdle;
@@ -84,7 +156,7 @@ static void poll_period_response_set(void)
 		error = otLinkSetPollPeriod(instance, RESPONSE_POLL_PERIOD);
 		__ASSERT(error == OT_ERROR_NONE, "Failed to set pool period");
 
-		LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
+		HOT_LOG_INF("Poll Period: %dms set", RESPONSE_POLL_PERIOD);
 	}
 }
 
@@ -101,11 +173,192 @@ static void poll_period_restore(void)
 		error = otLinkSetPollPeriod(instance, poll_period);
 		__ASSERT_NO_MSG(error == OT_ERROR_NONE);
 
-		LOG_INF("Poll Period: %dms restored", poll_period);
+		HOT_LOG_INF("Poll Period: %dms restored", poll_period);
 		poll_period = 0;
 	}
 }
 
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+/* Slot out of equal slots of the period, valid when slot_count is set */
+static uint32_t phase_slot;
+static uint32_t phase_slot_count;
+#endif
+
+#if defined(CONFIG_SENSOR_NODE_ID)
+static void node_id_from_eui64(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otExtAddress eui64;
+
+	openthread_api_mutex_lock(context);
+	otLinkGetFactoryAssignedIeeeEui64(context->instance, &eui64);
+	openthread_api_mutex_unlock(context);
+
+	bin2hex(eui64.m8, sizeof(eui64.m8), node_id, sizeof(node_id));
+}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+/* The provisioned server followed by the ";alt=<addr>" ones */
+static struct in6_addr servers[1 + CONFIG_COAP_CLIENT_ALT_SERVERS];
+static uint8_t server_count;
+static uint8_t server_index;
+static atomic_t server_failures;	/* Unanswered exchanges in a row */
+static struct k_work failover_work;
+static struct k_work_delayable reprovision_work;
+
+/* Called with the outcome of every exchange the server has to answer */
+static void server_exchange_result(bool answered)
+{
+	if (answered) {
+		atomic_clear(&server_failures);
+		k_work_cancel_delayable(&reprovision_work);
+		return;
+	}
+
+	if (atomic_inc(&server_failures) + 1 ==
+	    CONFIG_COAP_CLIENT_FAILOVER_THRESHOLD) {
+		k_work_submit(&failover_work);
+	}
+}
+
+static void server_failover(struct k_work *item)
+{
+	char str[INET6_ADDRSTRLEN];
+	k_spinlock_key_t key;
+	bool switched;
+
+	ARG_UNUSED(item);
+
+	atomic_clear(&server_failures);
+
+	key = k_spin_lock(&server_lock);
+	switched = server_count > 1;
+	if (switched) {
+		server_index = (server_index + 1) % server_count;
+		server_addr_set(&servers[server_index]);
+	}
+	memcpy(str, unique_local_addr_str, sizeof(str));
+	k_spin_unlock(&server_lock, key);
+
+	if (switched) {
+		LOG_WRN("Server not answering, switching to %s", str);
+	} else {
+		LOG_WRN("Server %s not answering", str);
+	}
+
+	/* Look for a server that came back with a new address */
+	k_work_reschedule(&reprovision_work, K_NO_WAIT);
+}
+
+static void server_reprovision(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+	coap_client_send_provisioning_request();
+	k_work_reschedule(&reprovision_work,
+			  K_SECONDS(CONFIG_COAP_CLIENT_REPROVISION_INTERVAL_S));
+}
+
+/* A provisioning reply names a new primary, alternates follow */
+static void server_list_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&server_lock);
+
+	servers[0] = unique_local_addr.sin6_addr;
+	server_count = 1;
+	server_index = 0;
+	k_spin_unlock(&server_lock, key);
+
+	atomic_clear(&server_failures);
+	k_work_cancel_delayable(&reprovision_work);
+}
+
+static void server_list_add(const char *addr)
+{
+	struct in6_addr server;
+	k_spinlock_key_t key;
+	bool added = false;
+
+	if (inet_pton(AF_INET6, addr, &server)) {
+		key = k_spin_lock(&server_lock);
+		if (server_count < ARRAY_SIZE(servers)) {
+			servers[server_count++] = server;
+			added = true;
+		}
+		k_spin_unlock(&server_lock, key);
+	}
+
+	if (!added) {
+		LOG_WRN("Ignoring alternate server: %s", addr);
+	}
+}
+#endif /* CONFIG_COAP_CLIENT_FAILOVER */
+
+/* Provisioning replies carry the server address, optionally followed by
+ * ";key=value" extensions, e.g.
+ * "fd00::1;slot=3/50;id=17;alt=fd00::2".
+ */
+static void handle_provisioning_option(const char *key, const char *value)
+{
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	if (!strcmp(key, "alt")) {
+		server_list_add(value);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	if (!strcmp(key, "oscore")) {
+		oscore_client_provision(value);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_SENSOR_NODE_ID)
+	if (!strcmp(key, "id")) {
+		unsigned long id;
+		char *end;
+
+		errno = 0;
+		id = strtoul(value, &end, 10);
+		if (end == value || *end != '\0' || id == 0 || id > UINT32_MAX ||
+		    errno) {
+			LOG_WRN("Invalid node id: %s", value);
+			return;
+		}
+
+		snprintf(node_id, sizeof(node_id), "%lu", id);
+		LOG_INF("Assigned node id %s", node_id);
+		return;
+	}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+	if (!strcmp(key, "slot")) {
+		uint32_t slot, count = 0;
+		char *end;
+
+		slot = strtoul(value, &end, 10);
+		if (*end == '/') {
+			count = strtoul(end + 1, NULL, 10);
+		}
+
+		if (slot >= count) {
+			LOG_WRN("Invalid slot: %s", value);
+			return;
+		}
+
+		phase_slot = slot;
+		phase_slot_count = count;
+		LOG_INF("Assigned slot %u of %u", slot, count);
+		return;
+	}
+#endif
+
+	LOG_DBG("Ignoring provisioning option '%s'", key);
+}
+
 static int on_provisioning_reply(const struct coap_packet *response,
 				 struct coap_reply *reply,
 				 const struct sockaddr *from)
@@ -113,6 +366,10 @@ static int on_provisioning_reply(const struct coap_packet *response,
 	int ret = 0;
 	const uint8_t *payload;
 	uint16_t payload_size = 0u;
+	char text[INET6_ADDRSTRLEN + 64] = {0};
+	char *addr, *option, *save;
+	struct in6_addr server;
+	k_spinlock_key_t key;
 	
 	//Testing for printing out IPaddr from OT
 	// otInstance *instance = openthread_get_default_instance();
@@ -153,14 +410,33 @@ static int on_provisioning_reply(const struct coap_packet *response,
 	// }
 
 	// LOG_HEXDUMP_INF(ipaddr_int, 16, "Fully converted IP fragment");
-	if (!inet_pton(AF_INET6, payload, &unique_local_addr.sin6_addr)){
-		LOG_ERR("Received data is not IPv6 address: %d", errno);
-		ret = -errno;
+	memcpy(text, payload, MIN(payload_size, sizeof(text) - 1));
+	addr = strtok_r(text, ";", &save);
+
+	if (!addr || !inet_pton(AF_INET6, addr, &server)){
+		LOG_ERR("Received data is not IPv6 address");
+		ret = -EINVAL;
 		goto exit;
 	}
-	memcpy(unique_local_addr_str, payload, payload_size);
 
-	LOG_INF("Received peer address: %s", unique_local_addr_str);
+	key = k_spin_lock(&server_lock);
+	server_addr_set(&server);
+	k_spin_unlock(&server_lock, key);
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_list_reset();
+#endif
+
+	while ((option = strtok_r(NULL, ";", &save)) != NULL) {
+		char *value = strchr(option, '=');
+
+		if (value) {
+			*value++ = '\0';
+			handle_provisioning_option(option, value);
+		}
+	}
+
+	LOG_INF("Received peer address: %s", addr);
 
 exit:
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
@@ -170,38 +446,331 @@ exit:
 	return ret;
 }
 
-static void send_sensor_data(struct k_work *item)
+#if defined(CONFIG_SENSOR_POLL_WITH_REPORT)
+/* Data frames of the last report that have not left the radio yet */
+static atomic_t report_frames;
+static struct k_work report_poll_work;
+
+static void send_report_poll(struct k_work *item)
 {
+	struct openthread_context *context = openthread_get_default_context();
+
 	ARG_UNUSED(item);
 
-	char payload [20];
+	openthread_api_mutex_lock(context);
+	if (!is_mtd_in_med_mode(context->instance)) {
+		otLinkSendDataRequest(context->instance);
+	}
+	openthread_api_mutex_unlock(context);
+}
+
+/* Poll the parent once the report is out, while the radio is up anyway.
+ * Polling right away could put the poll ahead of the report, which is
+ * still on its way through the IP stack.
+ */
+static void poll_with_report(atomic_val_t frames)
+{
+	atomic_set(&report_frames, frames);
+}
+
+void coap_client_data_frame_sent(void)
+{
+	if (atomic_get(&report_frames) > 0 &&
+	    atomic_dec(&report_frames) == 1) {
+		k_work_submit(&report_poll_work);
+	}
+}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+/* Give up on an ACK well before the next report is due */
+static const otCoapTxParameters confirmable_tx_params = {
+	.mAckTimeout = 2000,
+	.mAckRandomFactorNumerator = 3,
+	.mAckRandomFactorDenominator = 2,
+	.mMaxRetransmit = 2,
+};
+
+static void on_confirmable_ack(void *context, otMessage *message,
+			       const otMessageInfo *message_info,
+			       otError result)
+{
+	ARG_UNUSED(message);
+	ARG_UNUSED(message_info);
+
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+
+	if (result != OT_ERROR_NONE) {
+		LOG_WRN("'%s' not acknowledged: %d", (const char *)context,
+			result);
+	}
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_exchange_result(result == OT_ERROR_NONE);
+#endif
+}
+
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+static int on_protected_ack(const struct coap_packet *response,
+			    struct coap_reply *reply,
+			    const struct sockaddr *from)
+{
+	ARG_UNUSED(reply);
+	ARG_UNUSED(from);
+
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+
+	if (!response) {
+		LOG_WRN("Protected request not acknowledged");
+	}
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_exchange_result(response != NULL);
+#endif
+
+	return 0;
+}
+
+static void send_protected_confirmable(enum coap_method method,
+				       const char *const *path,
+				       const char *payload)
+{
+	struct sockaddr_in6 server;
+	int ret;
+
+	server_addr_get(&server, NULL);
+
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_response_set();
+	}
+
+	ret = oscore_client_send(true, method, &server, path,
+				 payload, strlen(payload), on_protected_ack);
+	if (ret) {
+		LOG_ERR("Cannot send protected '%s' request: %d", path[0], ret);
+		if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+			poll_period_restore();
+		}
+	}
+}
+#endif
+
+/* Send a confirmable request through the OpenThread CoAP service */
+static void send_confirmable(enum coap_method method, const char *const *path,
+			     const char *payload)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otMessageInfo message_info = { 0 };
+	struct sockaddr_in6 server;
+	otMessage *message;
+	otError error = OT_ERROR_NO_BUFS;
+
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	/* The OpenThread service can't carry OSCORE, it has its own socket */
+	send_protected_confirmable(method, path, payload);
+	return;
+#endif
+
+	server_addr_get(&server, NULL);
+
+	openthread_api_mutex_lock(context);
+
+	message = otCoapNewMessage(context->instance, NULL);
+	if (message == NULL) {
+		goto exit;
+	}
+
+	/* CoAP method codes are the same in both APIs */
+	otCoapMessageInit(message, OT_COAP_TYPE_CONFIRMABLE, (otCoapCode)method);
+	otCoapMessageGenerateToken(message, OT_COAP_DEFAULT_TOKEN_LENGTH);
+
+	error = OT_ERROR_NONE;
+	for (int i = 0; path[i] && error == OT_ERROR_NONE; i++) {
+		error = otCoapMessageAppendUriPathOptions(message, path[i]);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageAppendContentFormatOption(
+			message, OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapMessageSetPayloadMarker(message);
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otMessageAppend(message, payload, strlen(payload));
+	}
+	if (error != OT_ERROR_NONE) {
+		goto exit;
+	}
+
+	memcpy(&message_info.mPeerAddr, &server.sin6_addr,
+	       sizeof(message_info.mPeerAddr));
+	message_info.mPeerPort = COAP_PORT;
+
+	/* Poll fast enough for the ACK to make it through the parent */
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_response_set();
+	}
+
+	error = otCoapSendRequestWithParameters(context->instance, message,
+						&message_info,
+						on_confirmable_ack,
+						(void *)path[0],
+						&confirmable_tx_params);
+	if (error != OT_ERROR_NONE && IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+
+exit:
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' request: %d", path[0], error);
+		if (message) {
+			otMessageFree(message);
+		}
+	}
+
+	openthread_api_mutex_unlock(context);
+}
+#endif
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+/* Every Nth report is confirmable, its ACK shows the server is alive */
+static bool send_confirmable_report(const char *payload)
+{
+	static uint32_t unconfirmed;
+
+	if (++unconfirmed < CONFIG_COAP_CLIENT_CONFIRM_EVERY) {
+		return false;
+	}
+	unconfirmed = 0;
+
+	send_confirmable(COAP_METHOD_PUT, node_option, payload);
+
+	return true;
+}
+#else
+static bool send_confirmable_report(const char *payload)
+{
+	ARG_UNUSED(payload);
+
+	return false;
+}
+#endif /* CONFIG_COAP_CLIENT_FAILOVER */
+
+#if defined(CONFIG_SENSOR_ALARMS)
+static void on_alarm_done(bool acked)
+{
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	server_exchange_result(acked);
+#endif
+}
+
+static void send_alarm(const char *text, size_t len)
+{
+	struct sockaddr_in6 server;
+
+	server_addr_get(&server, NULL);
+
+	/* Poll fast enough for the ACK to make it through the parent */
+	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_response_set();
+	}
+
+	if (alarm_send(&server, alarm_option, text, len, on_alarm_done) &&
+	    IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		poll_period_restore();
+	}
+}
+#endif
+
+/* Non-confirmable report, protected if OSCORE is enabled */
+static void send_report(const struct sockaddr_in6 *server, const char *payload)
+{
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	/* Never fall back to plain text */
+	int ret = oscore_client_send(false, COAP_METHOD_PUT, server,
+				     node_option, payload, strlen(payload),
+				     NULL);
+
+	if (ret) {
+		LOG_WRN("Cannot send protected report: %d", ret);
+	}
+#else
+	coap_send_request(COAP_METHOD_PUT, (const struct sockaddr *)server,
+			  node_option, payload, strlen(payload), NULL);
+#endif
+}
+
+static void build_sensor_payload(char *payload)
+{
 	char sprint_buffer [20];
 	const char slash[] = "/";
 
 	/* Convert temperature into payload, then concat slash,
 	then convert temperature to payload and concat that*/
 	snprintfcb(payload,10, "%.1f", sensor_data_container.temperature);
-	LOG_INF("Payload after sprintf: %s", payload);
+	HOT_LOG_INF("Payload after sprintf: %s", payload);
 	snprintfcb(sprint_buffer,10 , "%.0f", sensor_data_container.humidity);
 	
 	strcat(payload, slash);
 	strcat(payload, sprint_buffer);
 
-	if (unique_local_addr.sin6_addr.s6_addr16[0] == 0) {
+	/* Let the backend know how far apart the readings are */
+	if (sensor_data_container.period_ms) {
+		snprintfcb(sprint_buffer, sizeof(sprint_buffer), "%u",
+			   sensor_data_container.period_ms);
+		strcat(payload, slash);
+		strcat(payload, sprint_buffer);
+	}
+}
+
+static void send_sensor_data(char *payload)
+{
+	struct sockaddr_in6 server;
+	char str[INET6_ADDRSTRLEN];
+
+	server_addr_get(&server, str);
+
+#if defined(CONFIG_SENSOR_BINDING_GROUP)
+	/* Bound heaters get the reading straight away, without the server */
+	coap_send_request(COAP_METHOD_PUT,
+			  (const struct sockaddr *)&binding_group_addr,
+			  binding_option, payload, strlen(payload), NULL);
+#endif
+
+	if (server.sin6_addr.s6_addr16[0] == 0) {
 		LOG_WRN("Peer address not set. Activate 'provisioning' option "
 			"on the server side");
 		return;
 	}
 
-	LOG_INF("Sending sensor data to: %s", unique_local_addr_str);
-	LOG_INF("Payload sent: %s", payload);
+	HOT_LOG_INF("Sending sensor data to: %s", str);
+	HOT_LOG_INF("Payload sent: %s", payload);
 	//thread_analyzer_print();
-	coap_send_request(COAP_METHOD_PUT,
-			  (const struct sockaddr *)&unique_local_addr,
-			  node_option, payload, strlen(payload), NULL);
+	PIPELINE_TRACE(TRACE_COAP_SEND, strlen(payload), 0);
+	if (!send_confirmable_report(payload)) {
+		send_report(&server, payload);
+	}
+	PIPELINE_TRACE(TRACE_COAP_SENT, strlen(payload), 0);
+
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_count(ENERGY_EVENT_REPORT);
+	}
+
+#if defined(CONFIG_SENSOR_POLL_WITH_REPORT)
+	/* The binding group copy leaves through the parent as well */
+	poll_with_report(IS_ENABLED(CONFIG_SENSOR_BINDING_GROUP) ? 2 : 1);
+#endif
 }
 
-static void send_provisioning_request(struct k_work *item)
+static void send_provisioning_request(void)
 {
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
 		/* decrease the polling period for higher responsiveness */
@@ -234,10 +803,19 @@ static void toggle_minimal_sleepy_end_device(struct k_work *item)
 
 	__ASSERT_NO_MSG(context != NULL);
 
+	/* Book the listen time spent in the outgoing mode */
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_update();
+	}
+
 	openthread_api_mutex_lock(context);
 	mode = otThreadGetLinkMode(context->instance);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	error = csl_toggle_link_mode(context->instance, &mode);
+#else
 	mode.mRxOnWhenIdle = !mode.mRxOnWhenIdle;
 	error = otThreadSetLinkMode(context->instance, mode);
+#endif
 	openthread_api_mutex_unlock(context);
 
 	if (error != OT_ERROR_NONE) {
@@ -264,25 +842,42 @@ static void on_thread_state_changed(uint32_t flags, void *context)
 		case OT_DEVICE_ROLE_ROUTER:
 		case OT_DEVICE_ROLE_LEADER:
 			k_work_submit(&on_connect_work);
-			is_connected = true;
+			tx_queue_set_connected(true);
 			break;
 
 		case OT_DEVICE_ROLE_DISABLED:
 		case OT_DEVICE_ROLE_DETACHED:
 		default:
 			k_work_submit(&on_disconnect_work);
-			is_connected = false;
+			tx_queue_set_connected(false);
 			break;
 		}
 	}
 }
 
-static void submit_work_if_connected(struct k_work *work)
+static void send_queued(uint8_t kind, const uint8_t *payload, size_t len)
 {
-	if (is_connected) {
-		k_work_submit(work);
-	} else {
-		LOG_INF("Connection is broken");
+	char text[CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD + 1];
+
+	switch (kind) {
+	case TX_KIND_PROVISIONING:
+		send_provisioning_request();
+		break;
+
+	case TX_KIND_SENSOR_DATA:
+		memcpy(text, payload, len);
+		text[len] = '\0';
+		send_sensor_data(text);
+		break;
+
+#if defined(CONFIG_SENSOR_ALARMS)
+	case TX_KIND_ALARM:
+		send_alarm((const char *)payload, len);
+		break;
+#endif
+
+	default:
+		break;
 	}
 }
 
@@ -291,6 +886,25 @@ bool isProvisioned(){
 	return unique_local_addr_str[0];
 }
 
+const char *coap_client_get_node_id(void)
+{
+#if defined(CONFIG_SENSOR_NODE_ID)
+	return node_id;
+#else
+	return NODE1_URI_PATH;
+#endif
+}
+
+bool coap_utils_is_server_addr(const struct in6_addr *addr)
+{
+	struct sockaddr_in6 server;
+
+	server_addr_get(&server, NULL);
+
+	return isProvisioned() &&
+	       !memcmp(addr, &server.sin6_addr, sizeof(*addr));
+}
+
 void coap_client_utils_init(ot_connection_cb_t on_connect,
 			    ot_disconnection_cb_t on_disconnect,
 			    mtd_mode_toggle_cb_t on_toggle)
@@ -299,10 +913,31 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
 
 	coap_init(AF_INET6, NULL);
 
+#if defined(CONFIG_SENSOR_NODE_ID)
+	/* Until the server assigns one, reports are filed under the EUI-64 */
+	node_id_from_eui64();
+#endif
+
+#if defined(CONFIG_SENSOR_BINDING_GROUP)
+	if (!inet_pton(AF_INET6, CONFIG_SENSOR_BINDING_GROUP_ADDR,
+		       &binding_group_addr.sin6_addr)) {
+		LOG_ERR("Invalid binding group: %s",
+			CONFIG_SENSOR_BINDING_GROUP_ADDR);
+	}
+#endif
+
 	k_work_init(&on_connect_work, on_connect);
 	k_work_init(&on_disconnect_work, on_disconnect);
-	k_work_init(&sensor_data_container.work_obj, send_sensor_data);
-	k_work_init(&provisioning_container.work_obj, send_provisioning_request);
+	tx_queue_init(send_queued);
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	if (oscore_client_init()) {
+		LOG_ERR("OSCORE unavailable, server exchanges are not sent");
+	}
+#endif
+#if defined(CONFIG_COAP_CLIENT_FAILOVER)
+	k_work_init(&failover_work, server_failover);
+	k_work_init_delayable(&reprovision_work, server_reprovision);
+#endif
 
 	openthread_set_state_changed_cb(on_thread_state_changed);
 	openthread_start(openthread_get_default_context());
@@ -312,22 +947,123 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
 			    toggle_minimal_sleepy_end_device);
 		update_device_state();
 	}
+
+#if defined(CONFIG_SENSOR_POLL_WITH_REPORT)
+	/* Every report polls and restarts the poll timer, so the timer
+	 * itself only fires once reports stop coming. A longer configured
+	 * period, e.g. from overlay-csl.conf, is kept.
+	 */
+	struct openthread_context *context = openthread_get_default_context();
+
+	k_work_init(&report_poll_work, send_report_poll);
+
+	openthread_api_mutex_lock(context);
+	otLinkSetPollPeriod(context->instance,
+			    MAX(CONFIG_OPENTHREAD_POLL_PERIOD,
+				2 * CONFIG_SENSOR_REPORT_PERIOD_MS));
+	openthread_api_mutex_unlock(context);
+#endif
+
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	/* Start as a synchronized sleepy end device */
+	csl_start();
+#endif
 }
 
 void coap_client_send_sensor_data(uint16_t temperature_data, uint16_t humidity_data)
 {
 	sensor_data_container.humidity =  (float) humidity_data/10;
-	sensor_data_container.temperature =  (float) temperature_data/10;
+	sensor_data_container.temperature = am2320_temperature(temperature_data) / 10.0f;
 
-	LOG_INF("new value: %f", sensor_data_container.humidity);
+	HOT_LOG_INF("new value: %f", sensor_data_container.humidity);
 	// sensor_data_container.humidity = 10.0;
 	// sensor_data_container.temperature = 10.0;
-	submit_work_if_connected(&sensor_data_container.work_obj);
+
+	/* Readings don't replace each other, a full queue loses the oldest */
+	char payload[CONFIG_COAP_CLIENT_TX_QUEUE_PAYLOAD];
+	int ret;
+
+	build_sensor_payload(payload);
+
+#if CONFIG_SENSOR_REPORT_BATCH > 1
+	/* Routine telemetry goes out a few readings at a time */
+	size_t used = strlen(batch);
+
+	if (batch_count && used + 1 + strlen(payload) >= sizeof(batch)) {
+		/* Out of room, send what we have and start over */
+		ret = tx_queue_push(TX_KIND_SENSOR_DATA, TX_QUEUE_PRIO_NORMAL,
+				    false, batch, used);
+		if (ret) {
+			LOG_WRN("Cannot queue sensor data (%d)", ret);
+		}
+		batch[0] = '\0';
+		batch_count = 0;
+		used = 0;
+	}
+
+	snprintf(batch + used, sizeof(batch) - used, "%s%s",
+		 batch_count ? ";" : "", payload);
+	if (++batch_count < CONFIG_SENSOR_REPORT_BATCH) {
+		return;
+	}
+
+	strcpy(payload, batch);
+	batch[0] = '\0';
+	batch_count = 0;
+#endif
+
+	ret = tx_queue_push(TX_KIND_SENSOR_DATA, TX_QUEUE_PRIO_NORMAL, false,
+			    payload, strlen(payload));
+	if (ret) {
+		LOG_WRN("Cannot queue sensor data (%d)", ret);
+	}
+}
+
+int coap_client_send_alarm(const char *text)
+{
+	if (!IS_ENABLED(CONFIG_SENSOR_ALARMS)) {
+		return -ENOTSUP;
+	}
+
+	/* Alarms jump the queue and are never merged */
+	return tx_queue_push(TX_KIND_ALARM, TX_QUEUE_PRIO_HIGH, false, text,
+			     strlen(text));
+}
+
+void coap_client_set_sample_period(uint32_t period_ms)
+{
+	sensor_data_container.period_ms = period_ms;
 }
 
 void coap_client_send_provisioning_request(void)
 {
-	submit_work_if_connected(&provisioning_container.work_obj);
+	/* Only the latest request matters */
+	tx_queue_push(TX_KIND_PROVISIONING, TX_QUEUE_PRIO_HIGH, true, NULL, 0);
+}
+
+int coap_client_set_csl_period(uint32_t period_ms)
+{
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	/* Book the listen time spent at the outgoing period */
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_update();
+	}
+
+	return csl_set_period(period_ms);
+#else
+	ARG_UNUSED(period_ms);
+
+	return -ENOTSUP;
+#endif
+}
+
+uint32_t coap_client_get_csl_period(void)
+{
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	return csl_get_period();
+#else
+	return 0;
+#endif
 }
 
 void coap_client_toggle_minimal_sleepy_end_device(void)
@@ -335,4 +1071,103 @@ void coap_client_toggle_minimal_sleepy_end_device(void)
 	if (IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
 		k_work_submit(&toggle_MTD_SED_work);
 	}
-}
\ No newline at end of file
+}
+
+int coap_client_set_link_mode(enum coap_client_link_mode mode)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otLinkModeConfig config;
+	otError error;
+
+	if (!IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED) ||
+	    (mode == COAP_CLIENT_LINK_SSED &&
+	     !IS_ENABLED(CONFIG_OPENTHREAD_CSL_RECEIVER))) {
+		return -ENOTSUP;
+	}
+
+	/* Book the listen time spent in the outgoing mode */
+	if (IS_ENABLED(CONFIG_SENSOR_ENERGY)) {
+		energy_update();
+	}
+
+	openthread_api_mutex_lock(context);
+	config = otThreadGetLinkMode(context->instance);
+	config.mRxOnWhenIdle = (mode == COAP_CLIENT_LINK_MED);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	/* CSL sampling only makes sense while the receiver sleeps */
+	csl_enable(context->instance, false);
+#endif
+	error = otThreadSetLinkMode(context->instance, config);
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+	if (error == OT_ERROR_NONE && mode == COAP_CLIENT_LINK_SSED) {
+		error = csl_enable(context->instance, true);
+	}
+#endif
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to set MLE link mode configuration");
+		return -EIO;
+	}
+
+	on_mtd_mode_toggle(config.mRxOnWhenIdle);
+
+	return 0;
+}
+
+int coap_client_set_poll_period(uint32_t period_ms)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otError error;
+
+	openthread_api_mutex_lock(context);
+	error = otLinkSetPollPeriod(context->instance, period_ms);
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to set poll period: %d", error);
+		return -EIO;
+	}
+
+	return 0;
+}
+
+uint32_t coap_client_get_phase(uint32_t period_ms)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otExtAddress eui64;
+	uint64_t hash = 0;
+
+	if (period_ms == 0) {
+		return 0;
+	}
+
+#if defined(CONFIG_COAP_CLIENT_PHASE_SLOT)
+	if (phase_slot_count) {
+		return (uint64_t)period_ms * phase_slot / phase_slot_count;
+	}
+#endif
+
+	if (!IS_ENABLED(CONFIG_COAP_CLIENT_PHASE_EUI64)) {
+		return 0;
+	}
+
+	openthread_api_mutex_lock(context);
+	otLinkGetFactoryAssignedIeeeEui64(context->instance, &eui64);
+	openthread_api_mutex_unlock(context);
+
+	for (int i = 0; i < sizeof(eui64.m8); i++) {
+		hash = (hash << 8) | eui64.m8[i];
+	}
+
+	/* MurmurHash3 finalizer, boards from one batch have consecutive
+	 * serials and a weaker mix leaves their phases clustered.
+	 */
+	hash ^= hash >> 33;
+	hash *= 0xff51afd7ed558ccdull;
+	hash ^= hash >> 33;
+	hash *= 0xc4ceb9fe1a85ec53ull;
+	hash ^= hash >> 33;
+
+	return hash % period_ms;
+}
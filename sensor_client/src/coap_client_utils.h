@@ -13,6 +13,8 @@
 #ifndef __COAP_CLIENT_UTILS_H__
 #define __COAP_CLIENT_UTILS_H__
 
+#include <zephyr/net/net_ip.h>
+
 /** @brief Struct for implementing k_work object as a member of a parent struct 
  * to enable passing of data to the function
  *
@@ -25,9 +27,9 @@ struct work_var_container{
 };
 
 struct work_sensor_container{
-	struct k_work 	work_obj; 		/*Store the work object here*/
 	float 			temperature;	/*Store the 'float' temperature data here*/
 	float			humidity;		/*Store the 'float' humidity data here*/
+	uint32_t		period_ms;		/*Sampling period appended to the report, 0 if fixed*/
 };
 
 /** @brief Type indicates function called when OpenThread connection
@@ -62,6 +64,18 @@ void coap_client_utils_init(ot_connection_cb_t on_connect,
  */
 void coap_client_send_sensor_data (uint16_t temperature_data, uint16_t humidity_data);
 
+/** @brief Send an alarm event to the provisioned server.
+ *
+ * Alarms go out ahead of queued telemetry as confirmable requests.
+ *
+ * @param[in] text Alarm payload, e.g. "temp=45.2".
+ *
+ * @retval 0 Alarm queued.
+ * @retval -ENOTSUP Alarms not enabled in this build.
+ * @retval -EINVAL Payload too long for the transmit queue.
+ */
+int coap_client_send_alarm(const char *text);
+
 
 /** @brief Request for the CoAP server address to pair.
  *
@@ -77,12 +91,96 @@ void coap_client_send_provisioning_request(void);
 
 bool isProvisioned(void);
 
+/** @brief Get the node id reports are filed under on the server.
+ *
+ * @return Decimal id assigned at provisioning, the EUI-64 in hex or, with
+ *         CONFIG_SENSOR_NODE_ID disabled, the shared resource name.
+ */
+const char *coap_client_get_node_id(void);
+
+/** @brief Check if an address is the one of the provisioned server.
+ *
+ * @param[in] addr IPv6 address to check.
+ */
+bool coap_utils_is_server_addr(const struct in6_addr *addr);
+
 /** @brief Toggle SED to MED and MED to SED modes.
+ *
+ * With CSL enabled the modes cycle MED, SED, SSED (CSL receiver) instead.
  *
  * @note Active when the device is working as Minimal Thread Device.
  */
 void coap_client_toggle_minimal_sleepy_end_device(void);
 
+/** @brief Thread link modes of a Minimal Thread Device. */
+enum coap_client_link_mode {
+	COAP_CLIENT_LINK_MED,	/* Receiver always on */
+	COAP_CLIENT_LINK_SED,	/* Polls the parent for frames */
+	COAP_CLIENT_LINK_SSED,	/* Samples the channel at the CSL period */
+};
+
+/** @brief Switch to a link mode.
+ *
+ * @retval 0        On success.
+ * @retval -ENOTSUP Mode not supported by this build.
+ * @retval -EIO     OpenThread rejected the mode.
+ */
+int coap_client_set_link_mode(enum coap_client_link_mode mode);
+
+/** @brief Account for a data frame that has left the radio.
+ *
+ * With CONFIG_SENSOR_POLL_WITH_REPORT the parent is polled once the
+ * frames of a report are sent.
+ *
+ * @note Called from the OpenThread radio callbacks.
+ */
+void coap_client_data_frame_sent(void);
+
+/** @brief Set the data poll period of a sleepy end device.
+ *
+ * @param[in] period_ms Poll period in milliseconds, 0 to let OpenThread
+ *                      derive it from the child timeout.
+ *
+ * @retval 0    On success.
+ * @retval -EIO OpenThread rejected the period.
+ */
+int coap_client_set_poll_period(uint32_t period_ms);
+
+/** @brief Set the CSL period used in SSED mode.
+ *
+ * Applied right away if the device is sleepy.
+ *
+ * @param[in] period_ms CSL period in milliseconds.
+ *
+ * @retval 0        On success.
+ * @retval -EINVAL  Period out of range.
+ * @retval -ENOTSUP Built without CSL receiver support.
+ * @retval -EIO     OpenThread rejected the period.
+ */
+int coap_client_set_csl_period(uint32_t period_ms);
+
+/** @brief Get the CSL period in use, 0 when not sampling.
+ */
+uint32_t coap_client_get_csl_period(void);
+
+/** @brief Set the sampling period appended to the following reports.
+ *
+ * @param[in] period_ms Effective sampling period, 0 to leave it out.
+ */
+void coap_client_set_sample_period(uint32_t period_ms);
+
+/** @brief Get the offset of the periodic exchange within its period.
+ *
+ * A slot assigned in the provisioning reply takes precedence. Otherwise
+ * the phase is derived from the factory EUI-64 when enabled, so nodes
+ * powered up together spread over the period.
+ *
+ * @param[in] period_ms Period of the exchange in milliseconds.
+ *
+ * @return Phase in milliseconds, below @p period_ms.
+ */
+uint32_t coap_client_get_phase(uint32_t period_ms);
+
 #endif
 
 /**
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/openthread.h>
+#include <openthread/coap.h>
+
+#include <string.h>
+
+#include "coap_server_client_interface.h"
+#include "coap_client_utils.h"
+#include "coap_server.h"
+#include "energy.h"
+#include "node_config.h"
+
+LOG_MODULE_DECLARE(coap_client_utils);
+
+static otError send_response(otMessage *request,
+			     const otMessageInfo *message_info,
+			     otCoapCode code, const char *payload)
+{
+	otInstance *instance = openthread_get_default_instance();
+	otMessage *response;
+	otCoapType type;
+	otError error;
+
+	response = otCoapNewMessage(instance, NULL);
+	if (response == NULL) {
+		return OT_ERROR_NO_BUFS;
+	}
+
+	type = (otCoapMessageGetType(request) == OT_COAP_TYPE_CONFIRMABLE) ?
+	       OT_COAP_TYPE_ACKNOWLEDGMENT : OT_COAP_TYPE_NON_CONFIRMABLE;
+
+	error = otCoapMessageInitResponse(response, request, type, code);
+	if (error == OT_ERROR_NONE && payload) {
+		error = otCoapMessageAppendContentFormatOption(
+			response, OT_COAP_OPTION_CONTENT_FORMAT_TEXT_PLAIN);
+		if (error == OT_ERROR_NONE) {
+			error = otCoapMessageSetPayloadMarker(response);
+		}
+		if (error == OT_ERROR_NONE) {
+			error = otMessageAppend(response, payload,
+						strlen(payload));
+		}
+	}
+	if (error == OT_ERROR_NONE) {
+		error = otCoapSendResponse(instance, response, message_info);
+	}
+	if (error != OT_ERROR_NONE) {
+		otMessageFree(response);
+	}
+
+	return error;
+}
+
+#if defined(CONFIG_SENSOR_ENERGY_COAP)
+static void on_diag_request(void *context, otMessage *message,
+			    const otMessageInfo *message_info)
+{
+	char text[192];
+	otError error;
+
+	ARG_UNUSED(context);
+
+	switch (otCoapMessageGetCode(message)) {
+	case OT_COAP_CODE_GET:
+		energy_format(text, sizeof(text));
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_CONTENT, text);
+		break;
+
+	case OT_COAP_CODE_DELETE:
+		energy_reset();
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_DELETED, NULL);
+		break;
+
+	default:
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_METHOD_NOT_ALLOWED, NULL);
+		break;
+	}
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' response: %d", DIAG_URI_PATH, error);
+	}
+}
+#endif /* CONFIG_SENSOR_ENERGY_COAP */
+
+#if defined(CONFIG_SENSOR_CONFIG_RESOURCE)
+static void on_config_request(void *context, otMessage *message,
+			      const otMessageInfo *message_info)
+{
+	char text[128] = {0};
+	uint16_t len;
+	otCoapCode code;
+	otError error;
+	int ret;
+
+	ARG_UNUSED(context);
+
+	switch (otCoapMessageGetCode(message)) {
+	case OT_COAP_CODE_GET:
+		node_config_format(text, sizeof(text));
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_CONTENT, text);
+		break;
+
+	case OT_COAP_CODE_PUT:
+	case OT_COAP_CODE_POST:
+		/* Only the server we were provisioned with may reconfigure */
+		len = otMessageGetLength(message) - otMessageGetOffset(message);
+		if (!coap_utils_is_server_addr((const struct in6_addr *)
+					       &message_info->mPeerAddr)) {
+			code = OT_COAP_CODE_FORBIDDEN;
+		} else if (len == 0) {
+			code = OT_COAP_CODE_BAD_REQUEST;
+		} else if (len >= sizeof(text)) {
+			/* Never apply the head of a truncated request */
+			code = OT_COAP_CODE_REQUEST_TOO_LARGE;
+		} else {
+			otMessageRead(message, otMessageGetOffset(message), text,
+				      len);
+			ret = node_config_set(text);
+			code = (ret == 0) ? OT_COAP_CODE_CHANGED :
+			       (ret == -ENOTSUP) ? OT_COAP_CODE_NOT_IMPLEMENTED :
+			       OT_COAP_CODE_BAD_REQUEST;
+		}
+		error = send_response(message, message_info, code, NULL);
+		break;
+
+	default:
+		error = send_response(message, message_info,
+				      OT_COAP_CODE_METHOD_NOT_ALLOWED, NULL);
+		break;
+	}
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Cannot send '%s' response: %d", NODE_CONFIG_URI_PATH,
+			error);
+	}
+}
+#endif /* CONFIG_SENSOR_CONFIG_RESOURCE */
+
+static otCoapResource resources[] = {
+#if defined(CONFIG_SENSOR_ENERGY_COAP)
+	{
+		.mUriPath = DIAG_URI_PATH,
+		.mHandler = on_diag_request,
+	},
+#endif
+#if defined(CONFIG_SENSOR_CONFIG_RESOURCE)
+	{
+		.mUriPath = NODE_CONFIG_URI_PATH,
+		.mHandler = on_config_request,
+	},
+#endif
+};
+
+int coap_server_init(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	otError error;
+
+	openthread_api_mutex_lock(context);
+
+	error = otCoapStart(context->instance, OT_DEFAULT_COAP_PORT);
+	if (error == OT_ERROR_NONE) {
+		for (int i = 0; i < ARRAY_SIZE(resources); i++) {
+			otCoapAddResource(context->instance, &resources[i]);
+		}
+	}
+
+	openthread_api_mutex_unlock(context);
+
+	if (error != OT_ERROR_NONE) {
+		LOG_ERR("Failed to start CoAP server: %d", error);
+		return -EIO;
+	}
+
+	return 0;
+}
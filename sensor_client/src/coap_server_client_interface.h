@@ -12,5 +12,16 @@
 #define PROVISIONING_URI_PATH "provisioning" 
 #define NODE1_URI_PATH "SensorNode1" 
 #define NODE2_URI_PATH "SensorNode2" 
+/* Sensors PUT their readings to "sensors/<node id>", the node id being
+ * either the decimal id from the ";id=N" provisioning option or, until
+ * one is assigned, the factory EUI-64 as 16 hex digits.
+ */
+#define SENSORS_URI_PATH "sensors"
+/* Alarm events are POSTed confirmable to "alarm/<node id>", or to "alarm"
+ * by nodes without one
+ */
+#define ALARM_URI_PATH "alarm"
+#define DIAG_URI_PATH "diag"
+#define NODE_CONFIG_URI_PATH "config"
 
 #endif
\ No newline at end of file
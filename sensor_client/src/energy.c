@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/openthread.h>
+#include <zephyr/sys/atomic.h>
+#include <openthread/link.h>
+#include <openthread/thread.h>
+
+#include <string.h>
+
+#if defined(CONFIG_PM)
+#include <zephyr/pm/pm.h>
+#endif
+
+#include "csl.h"
+#include "energy.h"
+
+/* 802.15.4 O-QPSK at 250 kbit/s, preamble, SFD and PHR precede the PSDU */
+#define US_PER_BYTE 32
+#define PHY_HEADER_BYTES 6
+
+/* Baselines and accumulators, all guarded by energy_lock */
+static struct {
+	int64_t start_ms;
+	int64_t listen_updated_ms;
+	uint64_t execution_cycles;
+	uint64_t idle_cycles;
+	uint32_t poll_base;
+	uint32_t polls;
+	uint64_t radio_tx_us;
+	uint64_t radio_rx_us;
+	uint64_t radio_listen_us;
+	uint32_t tx_frames;
+	uint32_t rx_frames;
+#if defined(CONFIG_PM)
+	uint64_t pm_residency_us[PM_STATE_COUNT];
+	uint32_t pm_entered;	/* Cycle count when the current state began */
+#endif
+} acc;
+
+static atomic_t events[ENERGY_EVENT_COUNT];
+static struct k_spinlock energy_lock;
+
+static void on_frame(const otRadioFrame *frame, bool is_tx, void *context)
+{
+	uint32_t airtime = (frame->mLength + PHY_HEADER_BYTES) * US_PER_BYTE;
+	k_spinlock_key_t key = k_spin_lock(&energy_lock);
+
+	ARG_UNUSED(context);
+
+	if (is_tx) {
+		acc.radio_tx_us += airtime;
+		acc.tx_frames++;
+	} else {
+		acc.radio_rx_us += airtime;
+		acc.rx_frames++;
+	}
+
+	k_spin_unlock(&energy_lock, key);
+}
+
+/* Book listen time since the last update, called with energy_lock held */
+static void update_listen_locked(otInstance *instance, int64_t now)
+{
+	int64_t elapsed_ms = now - acc.listen_updated_ms;
+	uint32_t polls = otLinkGetCounters(instance)->mTxDataPoll;
+
+	if (otThreadGetLinkMode(instance).mRxOnWhenIdle) {
+		acc.radio_listen_us += elapsed_ms * USEC_PER_MSEC;
+	} else {
+		acc.radio_listen_us += (uint64_t)(polls - acc.polls) *
+				       CONFIG_SENSOR_ENERGY_POLL_LISTEN_US;
+
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+		uint32_t csl_period_us = otLinkCslGetPeriod(instance) *
+					 CSL_PERIOD_UNIT_US;
+
+		if (csl_period_us) {
+			acc.radio_listen_us += elapsed_ms * USEC_PER_MSEC /
+					       csl_period_us *
+					       CONFIG_SENSOR_ENERGY_CSL_LISTEN_US;
+		}
+#endif
+	}
+
+	acc.listen_updated_ms = now;
+	acc.polls = polls;
+}
+
+#if defined(CONFIG_PM)
+static void on_pm_state_entry(enum pm_state state)
+{
+	acc.pm_entered = k_cycle_get_32();
+}
+
+static void on_pm_state_exit(enum pm_state state)
+{
+	k_spinlock_key_t key = k_spin_lock(&energy_lock);
+
+	acc.pm_residency_us[state] +=
+		k_cyc_to_us_floor64(k_cycle_get_32() - acc.pm_entered);
+	k_spin_unlock(&energy_lock, key);
+}
+
+static struct pm_notifier pm_notifier = {
+	.state_entry = on_pm_state_entry,
+	.state_exit = on_pm_state_exit,
+};
+#endif
+
+void energy_update(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	k_spinlock_key_t key;
+
+	openthread_api_mutex_lock(context);
+	key = k_spin_lock(&energy_lock);
+	update_listen_locked(context->instance, k_uptime_get());
+	k_spin_unlock(&energy_lock, key);
+	openthread_api_mutex_unlock(context);
+}
+
+void energy_count(enum energy_event event)
+{
+	atomic_inc(&events[event]);
+}
+
+void energy_reset(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	k_thread_runtime_stats_t cpu;
+	k_spinlock_key_t key;
+
+	k_thread_runtime_stats_all_get(&cpu);
+
+	openthread_api_mutex_lock(context);
+	key = k_spin_lock(&energy_lock);
+
+	memset(&acc, 0, sizeof(acc));
+	acc.start_ms = k_uptime_get();
+	acc.listen_updated_ms = acc.start_ms;
+	acc.execution_cycles = cpu.execution_cycles;
+	acc.idle_cycles = cpu.idle_cycles;
+	acc.polls = otLinkGetCounters(context->instance)->mTxDataPoll;
+	acc.poll_base = acc.polls;
+
+	k_spin_unlock(&energy_lock, key);
+	openthread_api_mutex_unlock(context);
+
+	for (int i = 0; i < ENERGY_EVENT_COUNT; i++) {
+		atomic_clear(&events[i]);
+	}
+}
+
+void energy_get(struct energy_stats *stats)
+{
+	struct openthread_context *context = openthread_get_default_context();
+	k_thread_runtime_stats_t cpu;
+	k_spinlock_key_t key;
+	uint64_t active_cycles, idle_cycles;
+	uint64_t charge;
+
+	k_thread_runtime_stats_all_get(&cpu);
+
+	openthread_api_mutex_lock(context);
+	key = k_spin_lock(&energy_lock);
+
+	update_listen_locked(context->instance, k_uptime_get());
+
+	stats->elapsed_us = (k_uptime_get() - acc.start_ms) * USEC_PER_MSEC;
+	stats->radio_tx_us = acc.radio_tx_us;
+	stats->radio_rx_us = acc.radio_rx_us;
+	stats->radio_listen_us = MAX(acc.radio_listen_us, acc.radio_rx_us);
+	stats->tx_frames = acc.tx_frames;
+	stats->rx_frames = acc.rx_frames;
+	stats->polls = acc.polls - acc.poll_base;
+#if defined(CONFIG_PM)
+	memcpy(stats->pm_residency_us, acc.pm_residency_us,
+	       sizeof(stats->pm_residency_us));
+#endif
+
+	idle_cycles = cpu.idle_cycles - acc.idle_cycles;
+	active_cycles = cpu.execution_cycles - acc.execution_cycles - idle_cycles;
+
+	k_spin_unlock(&energy_lock, key);
+	openthread_api_mutex_unlock(context);
+
+	stats->cpu_active_us = k_cyc_to_us_floor64(active_cycles);
+	stats->cpu_idle_us = k_cyc_to_us_floor64(idle_cycles);
+
+	for (int i = 0; i < ENERGY_EVENT_COUNT; i++) {
+		stats->events[i] = atomic_get(&events[i]);
+	}
+
+	/* Charge in uA * us, the radio draws on top of the CPU state */
+	charge = stats->cpu_active_us * CONFIG_SENSOR_ENERGY_CPU_ACTIVE_UA +
+		 stats->cpu_idle_us * CONFIG_SENSOR_ENERGY_SLEEP_UA +
+		 stats->radio_tx_us * CONFIG_SENSOR_ENERGY_RADIO_TX_UA +
+		 stats->radio_listen_us * CONFIG_SENSOR_ENERGY_RADIO_RX_UA;
+
+	stats->average_ua = stats->elapsed_us ? charge / stats->elapsed_us : 0;
+}
+
+int energy_format(char *buf, size_t len)
+{
+	struct energy_stats stats;
+	int ret;
+
+	energy_get(&stats);
+
+	ret = snprintk(buf, len,
+			"t=%llu;cpu=%llu;idle=%llu;tx=%llu;rx=%llu;listen=%llu;"
+			"txf=%u;rxf=%u;poll=%u;sample=%u;report=%u;uA=%u",
+			stats.elapsed_us / USEC_PER_MSEC,
+			stats.cpu_active_us / USEC_PER_MSEC,
+			stats.cpu_idle_us / USEC_PER_MSEC,
+			stats.radio_tx_us / USEC_PER_MSEC,
+			stats.radio_rx_us / USEC_PER_MSEC,
+			stats.radio_listen_us / USEC_PER_MSEC,
+			stats.tx_frames, stats.rx_frames, stats.polls,
+			stats.events[ENERGY_EVENT_SAMPLE],
+			stats.events[ENERGY_EVENT_REPORT], stats.average_ua);
+
+#if defined(CONFIG_PM)
+	for (int i = 0; i < PM_STATE_COUNT && (size_t)ret < len; i++) {
+		ret += snprintk(buf + ret, len - ret, ";pm%d=%llu", i,
+				stats.pm_residency_us[i] / USEC_PER_MSEC);
+	}
+#endif
+
+	return ret;
+}
+
+void energy_init(void)
+{
+	struct openthread_context *context = openthread_get_default_context();
+
+	energy_reset();
+
+	openthread_api_mutex_lock(context);
+	otLinkSetPcapCallback(context->instance, on_frame, NULL);
+	openthread_api_mutex_unlock(context);
+
+#if defined(CONFIG_PM)
+	pm_notifier_register(&pm_notifier);
+#endif
+}
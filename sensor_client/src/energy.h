@@ -0,0 +1,83 @@
+/**
+ * @file
+ * @defgroup energy Energy and CPU accounting
+ * @{
+ */
+
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef __ENERGY_H__
+#define __ENERGY_H__
+
+#include <stdint.h>
+
+#if defined(CONFIG_PM)
+#include <zephyr/pm/state.h>
+#endif
+
+enum energy_event {
+	ENERGY_EVENT_SAMPLE,
+	ENERGY_EVENT_REPORT,
+	ENERGY_EVENT_COUNT
+};
+
+/** @brief Accumulated usage since boot or the last energy_reset().
+ *
+ * Radio times are derived from the frame lengths at 250 kbit/s. Listen
+ * time of a sleepy device is estimated from its data polls and CSL
+ * samples, a rx-on-when-idle device listens all the time.
+ */
+struct energy_stats {
+	uint64_t elapsed_us;
+	uint64_t cpu_active_us;
+	uint64_t cpu_idle_us;
+	uint64_t radio_tx_us;
+	uint64_t radio_rx_us;
+	uint64_t radio_listen_us;	/* Includes radio_rx_us */
+	uint32_t tx_frames;
+	uint32_t rx_frames;
+	uint32_t polls;
+	uint32_t events[ENERGY_EVENT_COUNT];
+	uint32_t average_ua;		/* Estimate from the Kconfig currents */
+#if defined(CONFIG_PM)
+	uint64_t pm_residency_us[PM_STATE_COUNT];
+#endif
+};
+
+/** @brief Start accounting, to be called once OpenThread runs.
+ */
+void energy_init(void);
+
+/** @brief Count an application event.
+ */
+void energy_count(enum energy_event event);
+
+/** @brief Account the listen time up to now under the current link mode.
+ *
+ * Call before the link mode changes so the time is booked correctly.
+ */
+void energy_update(void);
+
+/** @brief Get the usage accumulated so far.
+ */
+void energy_get(struct energy_stats *stats);
+
+/** @brief Restart accounting from zero.
+ */
+void energy_reset(void);
+
+/** @brief Format the usage as "key=value;..." text.
+ *
+ * @return Number of characters written, as snprintk().
+ */
+int energy_format(char *buf, size_t len);
+
+#endif
+
+/**
+ * @}
+ */
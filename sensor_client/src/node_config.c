@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "coap_client_utils.h"
+#include "node_config.h"
+
+LOG_MODULE_DECLARE(coap_client_utils, CONFIG_COAP_CLIENT_UTILS_LOG_LEVEL);
+
+#define NODE_CONFIG_SETTINGS_KEY "sensor/config"
+#define NODE_CONFIG_TEXT_MAX 128
+
+/* SSED is only there with the CSL receiver built in */
+#if defined(CONFIG_OPENTHREAD_CSL_RECEIVER)
+#define CSL_PERIOD_DEFAULT CONFIG_COAP_CLIENT_CSL_PERIOD_MS
+#define LINK_MODE_DEFAULT COAP_CLIENT_LINK_SSED
+#define LINK_MODE_MAX COAP_CLIENT_LINK_SSED
+#else
+#define CSL_PERIOD_DEFAULT 0
+#define LINK_MODE_DEFAULT COAP_CLIENT_LINK_SED
+#define LINK_MODE_MAX COAP_CLIENT_LINK_SED
+#endif
+
+#if defined(CONFIG_SENSOR_ALARMS)
+#define ALARM_DEFAULT(name) CONFIG_SENSOR_ALARM_##name
+#else
+#define ALARM_DEFAULT(name) 0
+#endif
+
+struct param {
+	const char *name;
+	int32_t min;
+	int32_t max;
+	int32_t def;
+	bool supported;
+};
+
+static const struct param params[NODE_CONFIG_COUNT] = {
+	[NODE_CONFIG_PERIOD] = {
+		.name = "period",
+		/* The AM2320 needs 2 s between readings */
+		.min = 2000, .max = 3600000,
+		.def = CONFIG_SENSOR_REPORT_PERIOD_MS,
+		.supported = !IS_ENABLED(CONFIG_SENSOR_ADAPTIVE),
+	},
+	[NODE_CONFIG_POLL] = {
+		.name = "poll",
+		.min = 0, .max = 86400000,
+		.def = 0,
+		.supported = IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED),
+	},
+	[NODE_CONFIG_MODE] = {
+		.name = "mode",
+		.min = COAP_CLIENT_LINK_MED, .max = LINK_MODE_MAX,
+		.def = LINK_MODE_DEFAULT,
+		.supported = IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED),
+	},
+	[NODE_CONFIG_CSL] = {
+		.name = "csl",
+		.min = 1, .max = 10485,
+		.def = CSL_PERIOD_DEFAULT,
+		.supported = IS_ENABLED(CONFIG_OPENTHREAD_CSL_RECEIVER),
+	},
+	[NODE_CONFIG_TEMP_MAX] = {
+		.name = "temp_max",
+		.min = -40, .max = 80,
+		.def = ALARM_DEFAULT(TEMP_MAX),
+		.supported = IS_ENABLED(CONFIG_SENSOR_ALARMS),
+	},
+	[NODE_CONFIG_HUM_MAX] = {
+		.name = "hum_max",
+		.min = 0, .max = 100,
+		.def = ALARM_DEFAULT(HUM_MAX),
+		.supported = IS_ENABLED(CONFIG_SENSOR_ALARMS),
+	},
+	[NODE_CONFIG_HUM_STEP] = {
+		.name = "hum_step",
+		.min = 0, .max = 100,
+		.def = ALARM_DEFAULT(HUM_STEP),
+		.supported = IS_ENABLED(CONFIG_SENSOR_ALARMS),
+	},
+};
+
+static const char *const mode_names[] = {
+	[COAP_CLIENT_LINK_MED] = "med",
+	[COAP_CLIENT_LINK_SED] = "sed",
+	[COAP_CLIENT_LINK_SSED] = "ssed",
+};
+
+static int32_t values[NODE_CONFIG_COUNT];
+static uint32_t loaded;		/* Parameters restored from settings */
+static atomic_t dirty;		/* Parameters waiting to be stored */
+static node_config_changed_cb_t on_change;
+static struct k_work save_work;
+
+static int find_param(const char *name, size_t len)
+{
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (strlen(params[i].name) == len &&
+		    !strncmp(params[i].name, name, len)) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int parse_value(int id, const char *text, int32_t *value)
+{
+	char *end;
+	long parsed;
+
+	parsed = strtol(text, &end, 10);
+
+	/* A link mode may be given by name, it is range checked all the same */
+	for (int i = 0; id == NODE_CONFIG_MODE && i < ARRAY_SIZE(mode_names); i++) {
+		if (!strcmp(text, mode_names[i])) {
+			parsed = i;
+			end = (char *)text + strlen(text);
+		}
+	}
+
+	if (end == text || *end != '\0' ||
+	    parsed < params[id].min || parsed > params[id].max) {
+		return -EINVAL;
+	}
+
+	*value = parsed;
+
+	return 0;
+}
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+static int config_settings_set(const char *name, size_t len,
+			       settings_read_cb read_cb, void *cb_arg)
+{
+	int32_t value;
+	int id = find_param(name, strlen(name));
+	int ret;
+
+	if (id < 0 || len != sizeof(value)) {
+		return -EINVAL;
+	}
+
+	ret = read_cb(cb_arg, &value, sizeof(value));
+	if (ret < 0) {
+		return ret;
+	}
+
+	/* Ignore values a newer or older build would not accept */
+	if (!params[id].supported || value < params[id].min ||
+	    value > params[id].max) {
+		return 0;
+	}
+
+	values[id] = value;
+	loaded |= BIT(id);
+
+	return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(node_config, NODE_CONFIG_SETTINGS_KEY, NULL,
+			       config_settings_set, NULL, NULL);
+#endif
+
+/* Flash writes take a while, keep them out of the CoAP and shell paths */
+static void save_config(struct k_work *item)
+{
+	ARG_UNUSED(item);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	uint32_t pending = atomic_clear(&dirty);
+	char name[sizeof(NODE_CONFIG_SETTINGS_KEY) + 16];
+	int ret;
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!(pending & BIT(i))) {
+			continue;
+		}
+
+		snprintf(name, sizeof(name), NODE_CONFIG_SETTINGS_KEY "/%s",
+			 params[i].name);
+		ret = settings_save_one(name, &values[i], sizeof(values[i]));
+		if (ret) {
+			LOG_ERR("Cannot store '%s', (error: %d)", params[i].name,
+				ret);
+		}
+	}
+#endif
+}
+
+void node_config_init(void)
+{
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		values[i] = params[i].def;
+	}
+
+	k_work_init(&save_work, save_config);
+
+#if IS_ENABLED(CONFIG_SETTINGS)
+	int ret = settings_subsys_init();
+
+	if (!ret) {
+		ret = settings_load_subtree(NODE_CONFIG_SETTINGS_KEY);
+	}
+	if (ret) {
+		LOG_ERR("Cannot load configuration, (error: %d)", ret);
+	}
+#endif
+}
+
+void node_config_set_callback(node_config_changed_cb_t cb)
+{
+	int ret;
+
+	on_change = cb;
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (cb && (loaded & BIT(i))) {
+			ret = cb(i, values[i]);
+			if (ret) {
+				LOG_ERR("Cannot apply stored %s=%d, (error: %d)",
+					params[i].name, values[i], ret);
+			}
+		}
+	}
+}
+
+/* Apply the parameters in changed, or none of them */
+static int apply(uint32_t changed, const int32_t *pending)
+{
+	int32_t previous[NODE_CONFIG_COUNT];
+	int ret;
+
+	memcpy(previous, values, sizeof(previous));
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!(changed & BIT(i))) {
+			continue;
+		}
+
+		values[i] = pending[i];
+		ret = on_change ? on_change(i, values[i]) : 0;
+		if (ret) {
+			LOG_WRN("Cannot apply %s=%d, (error: %d)",
+				params[i].name, values[i], ret);
+
+			for (int j = i; j >= 0; j--) {
+				if (changed & BIT(j)) {
+					values[j] = previous[j];
+					(void)on_change(j, values[j]);
+				}
+			}
+			return -EIO;
+		}
+
+		LOG_INF("Config %s=%d", params[i].name, values[i]);
+	}
+
+	return 0;
+}
+
+int32_t node_config_get(enum node_config_id id)
+{
+	__ASSERT_NO_MSG(id < NODE_CONFIG_COUNT);
+
+	return values[id];
+}
+
+int node_config_set(const char *text)
+{
+	char buf[NODE_CONFIG_TEXT_MAX];
+	int32_t pending[NODE_CONFIG_COUNT];
+	uint32_t changed = 0;
+	char *item, *save;
+	int ret;
+
+	if (strlen(text) >= sizeof(buf)) {
+		return -EINVAL;
+	}
+	strcpy(buf, text);
+
+	/* Validate everything before touching anything */
+	for (item = strtok_r(buf, ";", &save); item;
+	     item = strtok_r(NULL, ";", &save)) {
+		char *value = strchr(item, '=');
+		int id;
+
+		if (!value) {
+			return -EINVAL;
+		}
+
+		id = find_param(item, value - item);
+		if (id < 0) {
+			return id;
+		}
+
+		if (!params[id].supported) {
+			return -ENOTSUP;
+		}
+
+		ret = parse_value(id, value + 1, &pending[id]);
+		if (ret) {
+			return ret;
+		}
+
+		changed |= BIT(id);
+	}
+
+	/* Nothing is stored unless the node could take it */
+	ret = apply(changed, pending);
+	if (ret) {
+		return ret;
+	}
+
+	atomic_or(&dirty, changed);
+	k_work_submit(&save_work);
+
+	return 0;
+}
+
+int node_config_format(char *buf, size_t len)
+{
+	int ret = 0;
+	size_t off;
+
+	buf[0] = '\0';
+
+	for (int i = 0; i < NODE_CONFIG_COUNT; i++) {
+		if (!params[i].supported) {
+			continue;
+		}
+
+		off = MIN((size_t)ret, len);
+
+		if (i == NODE_CONFIG_MODE) {
+			ret += snprintf(buf + off, len - off, "%s%s=%s",
+					ret ? ";" : "", params[i].name,
+					mode_names[values[i]]);
+		} else {
+			ret += snprintf(buf + off, len - off, "%s%s=%d",
+					ret ? ";" : "", params[i].name,
+					values[i]);
+		}
+	}
+
+	return ret;
+}
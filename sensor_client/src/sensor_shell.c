@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "coap_client_utils.h"
+#include "energy.h"
+#include "node_config.h"
+#include "oscore_client.h"
+#include "tx_queue.h"
+
+static int cmd_mode(const struct shell *sh, size_t argc, char **argv)
+{
+	if (!IS_ENABLED(CONFIG_OPENTHREAD_MTD_SED)) {
+		shell_error(sh, "Not built as a sleepy end device");
+		return -ENOTSUP;
+	}
+
+	coap_client_toggle_minimal_sleepy_end_device();
+
+	return 0;
+}
+
+static int cmd_csl(const struct shell *sh, size_t argc, char **argv)
+{
+	int ret;
+
+	if (argc > 1) {
+		ret = coap_client_set_csl_period(strtoul(argv[1], NULL, 10));
+		if (ret) {
+			shell_error(sh, "Cannot set CSL period (%d)", ret);
+			return ret;
+		}
+	}
+
+	shell_print(sh, "CSL period: %u ms", coap_client_get_csl_period());
+
+	return 0;
+}
+
+static int cmd_id(const struct shell *sh, size_t argc, char **argv)
+{
+	shell_print(sh, "Node id: %s", coap_client_get_node_id());
+
+	return 0;
+}
+
+static int cmd_queue(const struct shell *sh, size_t argc, char **argv)
+{
+	struct tx_queue_stats tx;
+
+	tx_queue_get_stats(&tx);
+	shell_print(sh, "%u queued, %u sent, %u coalesced, %u dropped",
+		    tx.queued, tx.sent, tx.coalesced, tx.dropped);
+
+	return 0;
+}
+
+static int cmd_oscore(const struct shell *sh, size_t argc, char **argv)
+{
+#if defined(CONFIG_COAP_CLIENT_OSCORE)
+	struct oscore_client_stats st;
+
+	oscore_client_get_stats(&st);
+	shell_print(sh, "Context:    %s",
+		    oscore_client_is_ready() ? "ready" : "not provisioned");
+	shell_print(sh, "Requests:   %u (%u timed out)", st.requests,
+		    st.timeouts);
+	shell_print(sh, "Responses:  %u (%u rejected)", st.responses,
+		    st.rejected);
+	if (st.requests) {
+		shell_print(sh, "Overhead:   %u bytes/request",
+			    (st.protected_bytes - st.plain_bytes) /
+			    st.requests);
+		shell_print(sh, "Protect:    %u us/request",
+			    st.protect_us / st.requests);
+	}
+	if (st.responses) {
+		shell_print(sh, "Unprotect:  %u us/response",
+			    st.unprotect_us / (st.responses + st.rejected));
+		shell_print(sh, "Round trip: %u ms average, %u ms max",
+			    st.rtt_ms / st.responses, st.rtt_max_ms);
+	}
+
+	return 0;
+#else
+	shell_error(sh, "Built without OSCORE");
+	return -ENOTSUP;
+#endif
+}
+
+static int cmd_config(const struct shell *sh, size_t argc, char **argv)
+{
+	char text[128] = {0};
+	int ret;
+
+	if (argc == 1) {
+		node_config_format(text, sizeof(text));
+
+		for (char *save, *item = strtok_r(text, ";", &save); item;
+		     item = strtok_r(NULL, ";", &save)) {
+			shell_print(sh, "%s", item);
+		}
+
+		return 0;
+	}
+
+	/* Apply all assignments together, or none of them */
+	for (size_t i = 1; i < argc; i++) {
+		if (strlen(text) + strlen(argv[i]) + 2 > sizeof(text)) {
+			shell_error(sh, "Too many parameters");
+			return -EINVAL;
+		}
+		if (i > 1) {
+			strcat(text, ";");
+		}
+		strcat(text, argv[i]);
+	}
+
+	ret = node_config_set(text);
+	if (ret) {
+		shell_error(sh, "Cannot set configuration (%d)", ret);
+	}
+
+	return ret;
+}
+
+#if defined(CONFIG_SENSOR_ENERGY)
+static int cmd_energy_show(const struct shell *sh, size_t argc, char **argv)
+{
+	struct energy_stats stats;
+
+	energy_get(&stats);
+
+	shell_print(sh, "Elapsed:    %llu ms", stats.elapsed_us / USEC_PER_MSEC);
+	shell_print(sh, "CPU active: %llu ms", stats.cpu_active_us / USEC_PER_MSEC);
+	shell_print(sh, "CPU idle:   %llu ms", stats.cpu_idle_us / USEC_PER_MSEC);
+#if defined(CONFIG_PM)
+	for (int i = 0; i < PM_STATE_COUNT; i++) {
+		shell_print(sh, "PM state %d: %llu ms", i,
+			    stats.pm_residency_us[i] / USEC_PER_MSEC);
+	}
+#endif
+	shell_print(sh, "Radio TX:   %llu ms (%u frames)",
+		    stats.radio_tx_us / USEC_PER_MSEC, stats.tx_frames);
+	shell_print(sh, "Radio RX:   %llu ms (%u frames)",
+		    stats.radio_rx_us / USEC_PER_MSEC, stats.rx_frames);
+	shell_print(sh, "Listen:     %llu ms", stats.radio_listen_us / USEC_PER_MSEC);
+	shell_print(sh, "Polls:      %u", stats.polls);
+	shell_print(sh, "Samples:    %u", stats.events[ENERGY_EVENT_SAMPLE]);
+	shell_print(sh, "Reports:    %u", stats.events[ENERGY_EVENT_REPORT]);
+	shell_print(sh, "Average:    %u uA (estimate)", stats.average_ua);
+
+	return 0;
+}
+
+static int cmd_energy_reset(const struct shell *sh, size_t argc, char **argv)
+{
+	energy_reset();
+
+	return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_energy,
+	SHELL_CMD(show, NULL, "Show the accumulated usage", cmd_energy_show),
+	SHELL_CMD(reset, NULL, "Restart the accounting", cmd_energy_reset),
+	SHELL_SUBCMD_SET_END
+);
+#define SUB_ENERGY (&sub_energy)
+#else
+#define SUB_ENERGY NULL
+#endif
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_sensor,
+	SHELL_CMD(mode, NULL, "Cycle the MED, SED and SSED link modes", cmd_mode),
+	SHELL_CMD_ARG(csl, NULL, "[period ms] Show or set the SSED CSL period",
+		      cmd_csl, 1, 1),
+	SHELL_CMD_ARG(config, NULL, "[key=value ...] Show or set the runtime configuration",
+		      cmd_config, 1, 8),
+	SHELL_CMD(id, NULL, "Show the node id reports are filed under", cmd_id),
+	SHELL_CMD(queue, NULL, "Show the transmit queue counters", cmd_queue),
+	SHELL_CMD(oscore, NULL, "Show the OSCORE overhead and round trips",
+		  cmd_oscore),
+	SHELL_COND_CMD(CONFIG_SENSOR_ENERGY, energy, SUB_ENERGY,
+		       "Energy and CPU accounting", NULL),
+	SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(sensor, &sub_sensor, "Sensor node commands", NULL);
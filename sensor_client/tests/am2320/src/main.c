@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/ztest.h>
+
+#include "am2320.h"
+
+/* Default CONFIG_SENSOR_ALARM_TEMP_MAX, in 0.1 degC as check_alarms() takes */
+#define TEMP_MAX (35 * 10)
+/* Lowest threshold the configuration accepts */
+#define TEMP_MAX_LOWEST (-40 * 10)
+
+ZTEST(am2320, test_positive_temperature)
+{
+	zassert_equal(am2320_temperature(0x00ea), 234);
+	zassert_equal(am2320_temperature(0x0000), 0);
+}
+
+ZTEST(am2320, test_negative_temperature)
+{
+	/* -10.1 degC, bit 15 carries the sign */
+	zassert_equal(am2320_temperature(0x8065), -101);
+	zassert_equal(am2320_temperature(0x8000), 0);
+	zassert_equal(am2320_temperature(0xffff), -32767);
+
+	/* Read as unsigned, sub-zero readings would be over any threshold */
+	zassert_true(am2320_temperature(0x8065) < TEMP_MAX);
+	zassert_true(am2320_temperature(0xffff) < TEMP_MAX);
+
+	/* -38.0 degC is over the lowest threshold, -41.0 degC is not */
+	zassert_true(am2320_temperature(0x817c) >= TEMP_MAX_LOWEST);
+	zassert_true(am2320_temperature(0x819a) < TEMP_MAX_LOWEST);
+}
+
+ZTEST_SUITE(am2320, NULL, NULL, NULL, NULL, NULL);